@@ -0,0 +1,189 @@
+// include following line to include clear action for testing deployment
+// #define INCLUDECLEARACTIONS
+
+#pragma once
+
+#include <eosio/asset.hpp>
+#include <eosio/crypto.hpp>
+#include <eosio/eosio.hpp>
+#include <eosio/singleton.hpp>
+
+#include <eosio.system/eosio.system.hpp>
+
+#include <vector>
+
+namespace eosiosystem {
+
+   using namespace eosio;
+
+   // used primarily for individual accounts cpu usage, but also totals metrics
+   struct metric {
+     name a;
+     uint64_t u;
+   };
+
+   struct [[eosio::table("resusagedata"), eosio::contract("eosio.oracle")]] datasets
+   {
+      uint64_t id;
+      checksum256 hash;
+      std::vector<metric> data; // hash of each individual data submission
+      uint16_t refs = 0; // resconsensus rows voting for this body, it is erased with the last one dropped
+      uint64_t primary_key() const { return (id); }
+      checksum256 by_hash() const { return hash; }
+   };
+
+   // holds the points score of oracles (based on commit-reveal and modal hash matches)
+   struct [[eosio::table("ressources"), eosio::contract("eosio.oracle")]] sources
+   {
+      name account;
+      uint32_t submissions_score;
+      uint32_t submissions_count;
+      uint64_t primary_key() const { return (account.value); }
+   };
+
+   // ressysusage, resusagedata, resconsensus and resdistrib are scoped by the period_start seconds they report on,
+   // so oracles can fill the next period while the current one is still open or being cleared
+
+   // totals data as submitted by each oracle for the period
+   struct [[eosio::table("ressysusage"), eosio::contract("eosio.oracle")]] system_usage
+   {
+      name source; // oracle source
+      uint64_t total_cpu_us;
+      uint64_t total_net_words;
+      uint64_t allocated_cpu = 0; // how much has been allocated to individual accounts
+      uint16_t submission_count = 0; // hashes committed so far, the totals plus each dataset
+      std::vector<checksum256> merkle_peaks; // incremental merkle frontier over the submission hashes
+      name last_account; // highest account submitted so far, later datasets must start above it when dedupe_mode is 1
+      checksum256 all_data_hash; // merkle root commitment for all subsequent data for scoring
+      uint64_t primary_key() const { return (source.value); }
+   };
+
+   // secondary key grouping consensus rows by dataset, hashes sharing the low 64 bits are told apart by scanning
+   inline uint128_t consensus_key(uint16_t dataset_id, const checksum256& hash) {
+      return (static_cast<uint128_t>(dataset_id) << 64) | static_cast<uint64_t>(hash.get_array()[0]);
+   }
+
+   // number of oracles which submitted each distinct hash per dataset for the period (dataset 0 is the totals)
+   struct [[eosio::table("resconsensus"), eosio::contract("eosio.oracle")]] consensus
+   {
+      uint64_t id;
+      uint16_t dataset_id;
+      checksum256 hash;
+      uint16_t count = 0;
+      uint64_t primary_key() const { return (id); }
+      uint128_t by_dataset_hash() const { return consensus_key(dataset_id, hash); }
+   };
+
+   // datasets of the period which reached consensus, accrued into resaccpay by distribute
+   // with dedupe_mode 1 each covers the account range first_account to last_account it pays, ranges never overlap
+   struct [[eosio::table("resdistrib"), eosio::contract("eosio.oracle")]] dataset_distribution
+   {
+      uint16_t dataset_id;
+      name first_account;
+      name last_account;
+      checksum256 hash; // resusagedata body being paid out
+      uint32_t row_count = 0; // accounts to accrue, 0 when paid through a claim root
+      uint32_t next_row = 0; // first account distribute has not accrued yet
+      std::vector<metric> rows; // the accounts paid when the body overlapped ranges already paid, empty when all of it is paid
+      uint64_t primary_key() const { return (dataset_id); }
+      uint64_t by_first_account() const { return first_account.value; }
+      uint64_t by_pending() const { return next_row < row_count ? 0 : 1; }
+   };
+
+
+   struct [[eosio::table("resaccpay"), eosio::contract("eosio.oracle")]] account_pay
+   {
+      name account; // account consuming the resource
+      asset balance; // asset balance
+      time_point_sec timestamp; // period of the last payout
+      uint64_t primary_key() const { return (account.value); }
+      uint64_t by_timestamp() const { return timestamp.sec_since_epoch(); }
+   };
+
+   // leaf of a claim tree, one per account in the consensus dataset, in dataset order
+   struct claim_leaf {
+      uint32_t index;
+      name account;
+      int64_t amount;
+   };
+
+   // merkle root over the payouts of one distributed dataset, paid out through claimproof
+   // once claim_expiry_seconds have passed since its period started sweepclaims erases it with what is left unclaimed
+   struct [[eosio::table("resclaims"), eosio::contract("eosio.oracle")]] claim_root
+   {
+      uint64_t id;
+      time_point_sec period_start;
+      uint16_t dataset_id;
+      uint32_t leaf_count;
+      checksum256 root;
+      std::vector<uint8_t> claimed; // bit i is set once leaf i has been paid
+      int64_t amount = 0; // sum of every leaf's payout
+      int64_t claimed_amount = 0; // paid out through claimproof so far
+      uint64_t primary_key() const { return (id); }
+      uint128_t by_period_dataset() const { return (static_cast<uint128_t>(period_start.sec_since_epoch()) << 64) | dataset_id; }
+   };
+
+
+   typedef eosio::multi_index<"ressources"_n, sources> sources_table;
+   typedef eosio::multi_index<"ressysusage"_n, system_usage> system_usage_table;
+   typedef eosio::multi_index<"resaccpay"_n, account_pay,
+            indexed_by<"expiry"_n, const_mem_fun<account_pay, uint64_t, &account_pay::by_timestamp>>> account_pay_table;
+   typedef eosio::multi_index<"resusagedata"_n, datasets, 
+            indexed_by<"hash"_n, const_mem_fun<datasets, checksum256, &datasets::by_hash>>> datasets_table;
+   typedef eosio::multi_index<"resconsensus"_n, consensus,
+            indexed_by<"datasethash"_n, const_mem_fun<consensus, uint128_t, &consensus::by_dataset_hash>>> consensus_table;
+   typedef eosio::multi_index<"resdistrib"_n, dataset_distribution,
+            indexed_by<"firstacct"_n, const_mem_fun<dataset_distribution, uint64_t, &dataset_distribution::by_first_account>>,
+            indexed_by<"pending"_n, const_mem_fun<dataset_distribution, uint64_t, &dataset_distribution::by_pending>>> dataset_distribution_table;
+   typedef eosio::multi_index<"resclaims"_n, claim_root,
+            indexed_by<"perioddata"_n, const_mem_fun<claim_root, uint128_t, &claim_root::by_period_dataset>>> claim_root_table;
+
+   /**
+    * eosio.oracle contract collects the usage reported by the resource oracles, asks eosio.system to issue
+    * each period's inflation through issueinfl and pays the utility share out of eosio.upay to the accounts measured.
+    * It reads the producer set, global limits and reshistory of eosio.system and runs in its own account
+    * so oracle submissions do not load the system contract.
+    */
+   class [[eosio::contract("eosio.oracle")]] oracle : public contract {
+      public:
+         oracle( name s, name code, datastream<const char*> ds );
+
+         static constexpr eosio::name system_account{"eosio"_n};
+         static constexpr eosio::name active_permission{"active"_n};
+         static constexpr eosio::name token_account{"eosio.token"_n};
+         static constexpr eosio::name upay_account{"eosio.upay"_n};
+
+         // resource actions defined in eosio.oracle.cpp
+         ACTION initresource(uint16_t dataset_batch_size, uint16_t oracle_consensus_threshold, time_point_sec period_start, uint32_t period_seconds);
+         ACTION settotalusg(name source, uint64_t total_cpu_us, uint64_t total_net_words, checksum256 all_data_hash, time_point_sec period_start);
+         ACTION addactusg(name source, uint16_t dataset_id, const std::vector<metric>& dataset, time_point_sec period_start);
+         ACTION addactusgz(name source, uint16_t dataset_id, const std::vector<char>& payload, time_point_sec period_start);
+         ACTION addactusgm(name source, uint16_t first_dataset_id, const std::vector<std::vector<metric>>& datasets, time_point_sec period_start);
+         ACTION voteactusg(name source, uint16_t dataset_id, checksum256 hash, time_point_sec period_start);
+         ACTION nextperiod(uint16_t max_rows);
+         ACTION rollover(uint16_t max_rows);
+         ACTION distribute(uint16_t dataset_id, uint16_t max_rows);
+         ACTION claimdistrib(name account);
+         ACTION claimmany(const std::vector<name>& accounts);
+         ACTION claimproof(name account, time_point_sec period_start, uint16_t dataset_id, uint32_t leaf_index, asset amount, const std::vector<checksum256>& proof);
+         ACTION resactivate(bool active);
+         ACTION sethashver(uint8_t hash_version);
+         ACTION setdistmode(uint8_t distribution_mode);
+         ACTION setdedupe(uint8_t dedupe_mode);
+         ACTION setclaimexp(uint32_t claim_expiry_seconds, name sweep_account);
+         ACTION sweepclaims(uint16_t max_rows);
+         ACTION importres(const std::vector<sources>& scores, const std::vector<account_pay>& pays);
+         #ifdef INCLUDECLEARACTIONS
+            ACTION clrresource();
+         #endif
+
+      private:
+         resource_config_singleton _resource_config;
+
+          // resource helper functions defined in eosio.oracle.cpp
+         void add_usage_datasets(name source, uint16_t first_dataset_id, const std::vector<std::vector<metric>>& datasets, const std::vector<checksum256>& hashes, time_point_sec period_start);
+         void transfer_inflation(uint64_t total_cpu_us, uint64_t total_net_words, time_point_sec period_start);
+         const char* rollover_step(uint32_t budget);
+   };
+
+}
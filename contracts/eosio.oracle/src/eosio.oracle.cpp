@@ -0,0 +1,1156 @@
+#include <eosio.oracle/eosio.oracle.hpp>
+#include <eosio.token/eosio.token.hpp>
+#include <algorithm>
+#include <limits>
+
+
+namespace eosiosystem {
+
+    // hash two merkle nodes into their parent
+    static checksum256 merkle_parent(const checksum256& left, const checksum256& right) {
+      std::array<uint8_t, 64> buf;
+      auto l = left.extract_as_byte_array();
+      auto r = right.extract_as_byte_array();
+      std::copy(l.begin(), l.end(), buf.begin());
+      std::copy(r.begin(), r.end(), buf.begin() + l.size());
+      return sha256(reinterpret_cast<const char*>(buf.data()), buf.size());
+    }
+
+    // append a leaf to an incremental merkle frontier which currently holds leaf_count leaves
+    // peaks are the roots of the perfect subtrees, largest first, so at most log2(leaf_count)+1 are stored
+    static void merkle_append(std::vector<checksum256>& peaks, uint64_t leaf_count, checksum256 leaf) {
+      while (leaf_count & 1) {
+        leaf = merkle_parent(peaks.back(), leaf);
+        peaks.pop_back();
+        leaf_count >>= 1;
+      }
+      peaks.push_back(leaf);
+    }
+
+    // fold the frontier into the merkle root (same tree shape as RFC 6962)
+    static checksum256 merkle_root(const std::vector<checksum256>& peaks) {
+      checksum256 root = peaks.back();
+      for (auto i = peaks.size() - 1; i > 0; i--) {
+        root = merkle_parent(peaks[i - 1], root);
+      }
+      return root;
+    }
+
+    // hash a usage dataset in the format selected by resource_config_state::hash_version
+    // version 0 hashes the concatenated text of each pair, version 1 hashes the packed metrics as received
+    static checksum256 hash_dataset(const std::vector<metric>& dataset, uint8_t hash_version) {
+      if (hash_version == 0) {
+        std::string datatext = "";
+        for (const auto& m : dataset) {
+          datatext += m.a.to_string();
+          datatext += std::to_string(m.u);
+        }
+        return sha256(datatext.c_str(), datatext.size());
+      }
+      auto packed = pack(dataset);
+      return sha256(packed.data(), packed.size());
+    }
+
+    // hash a totals submission in the format selected by resource_config_state::hash_version
+    static checksum256 hash_totals(uint64_t total_cpu_us, uint64_t total_net_words, uint8_t hash_version) {
+      if (hash_version == 0) {
+        std::string datatext = std::to_string(total_cpu_us) + "-" + std::to_string(total_net_words);
+        return sha256(datatext.c_str(), datatext.size());
+      }
+      return hash_dataset({{"cpu.us"_n, total_cpu_us}, {"net.words"_n, total_net_words}}, hash_version);
+    }
+
+    // scope of the usage tables holding a period's submissions
+    static uint64_t period_scope(time_point_sec period_start) {
+      return period_start.sec_since_epoch();
+    }
+
+    // check period_start is the open period or, once it has begun, the one after it, and return whether it is the open one
+    // the next period only collects submissions, nothing is paid out for it until nextperiod has advanced to it
+    static bool check_period(const resource_config_state& conf, time_point_sec period_start) {
+      if (period_start == conf.period_start) {
+        check(conf.rollover_stage != 1, "period rollover in progress");
+        return true;
+      }
+      check(period_start.sec_since_epoch() == conf.period_start.sec_since_epoch() + conf.period_seconds, "period_start does not match an open period");
+      check(current_time_point().sec_since_epoch() >= period_start.sec_since_epoch(), "next period has not started");
+      return false;
+    }
+
+    // true while any oracle has submitted totals for the open or the next period
+    static bool submissions_open(name self, const resource_config_state& conf) {
+      system_usage_table current(self, period_scope(conf.period_start));
+      system_usage_table next(self, period_scope(conf.period_start) + conf.period_seconds);
+      return current.begin() != current.end() || next.begin() != next.end();
+    }
+
+    // count one oracle's vote for a dataset hash and return how many oracles now agree on it
+    static uint16_t add_consensus_vote(name self, uint64_t scope, uint16_t dataset_id, const checksum256& hash) {
+      consensus_table c_t(self, scope);
+      auto c_idx = c_t.get_index<"datasethash"_n>();
+      auto key = consensus_key(dataset_id, hash);
+      auto c_itr = c_idx.lower_bound(key);
+      while (c_itr != c_idx.end() && c_itr->by_dataset_hash() == key && c_itr->hash != hash) {
+        c_itr++;
+      }
+      if (c_itr == c_idx.end() || c_itr->by_dataset_hash() != key) {
+        c_t.emplace(self, [&](auto& c) {
+          c.id = c_t.available_primary_key();
+          c.dataset_id = dataset_id;
+          c.hash = hash;
+          c.count = 1;
+        });
+        return 1;
+      }
+      uint16_t count = c_itr->count + 1;
+      c_idx.modify(c_itr, same_payer, [&](auto& c) {
+        c.count = count;
+      });
+      return count;
+    }
+
+    // erase up to max_rows rows from the front of a table and return how many were erased
+    template<typename Table>
+    static uint32_t erase_rows(Table& table, uint32_t max_rows) {
+      uint32_t erased = 0;
+      auto itr = table.begin();
+      while (itr != table.end() && erased < max_rows) {
+        itr = table.erase(itr);
+        erased++;
+      }
+      return erased;
+    }
+
+    // totals enough oracles of a period agreed on, false until the threshold is reached
+    static bool find_total_consensus(name self, time_point_sec period_start, uint16_t threshold, uint8_t hash_version, uint64_t& total_cpu_us, uint64_t& total_net_words) {
+      consensus_table c_t(self, period_scope(period_start));
+      auto c_idx = c_t.get_index<"datasethash"_n>();
+      for (auto c_itr = c_idx.lower_bound(consensus_key(0, checksum256())); c_itr != c_idx.end() && c_itr->dataset_id == 0; c_itr++) {
+        if (c_itr->count < threshold) continue;
+        system_usage_table u_t(self, period_scope(period_start));
+        for (const auto& u : u_t) {
+          if (hash_totals(u.total_cpu_us, u.total_net_words, hash_version) == c_itr->hash) {
+            total_cpu_us = u.total_cpu_us;
+            total_net_words = u.total_net_words;
+            return true;
+          }
+        }
+      }
+      return false;
+    }
+
+    // find the hash a dataset of the period reached consensus on, false while no hash has enough votes
+    static bool find_dataset_consensus(name self, uint64_t scope, uint16_t dataset_id, uint16_t threshold, checksum256& hash) {
+      consensus_table c_t(self, scope);
+      auto c_idx = c_t.get_index<"datasethash"_n>();
+      for (auto c_itr = c_idx.lower_bound(consensus_key(dataset_id, checksum256())); c_itr != c_idx.end() && c_itr->dataset_id == dataset_id; c_itr++) {
+        if (c_itr->count >= threshold) {
+          hash = c_itr->hash;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // the hash a dataset of the period settled on, the one queued or, for a next period dataset, the one agreed on
+    static bool find_settled_hash(name self, uint64_t scope, const dataset_distribution_table& dist_t, uint16_t dataset_id,
+                                  const resource_config_state& conf, checksum256& hash) {
+      auto dist_itr = dist_t.find(dataset_id);
+      if (dist_itr != dist_t.end()) {
+        hash = dist_itr->hash;
+        return true;
+      }
+      return find_dataset_consensus(self, scope, dataset_id, conf.oracle_consensus_threshold, hash);
+    }
+
+    // drop the votes for every other hash of a dataset which reached consensus on hash, and each body no other vote refers to
+    // a dataset has at most one hash per oracle so this is bounded by the oracle count
+    static void drop_losing_datasets(name self, uint64_t scope, datasets_table& d_t, uint16_t dataset_id, const checksum256& hash) {
+      consensus_table c_t(self, scope);
+      auto c_idx = c_t.get_index<"datasethash"_n>();
+      auto dt_hash_index = d_t.get_index<"hash"_n>();
+      auto c_itr = c_idx.lower_bound(consensus_key(dataset_id, checksum256()));
+      while (c_itr != c_idx.end() && c_itr->dataset_id == dataset_id) {
+        if (c_itr->hash == hash) {
+          c_itr++;
+          continue;
+        }
+        auto d_itr = dt_hash_index.find(c_itr->hash);
+        if (d_itr != dt_hash_index.end()) {
+          if (d_itr->refs <= 1) {
+            dt_hash_index.erase(d_itr);
+          } else {
+            dt_hash_index.modify(d_itr, same_payer, [&](auto& t) {
+              t.refs--;
+            });
+          }
+        }
+        c_itr = c_idx.erase(c_itr);
+      }
+    }
+
+    // share of the period's utility tokens earned by cpu_us of the total, rounded down
+    static int64_t usage_payout(uint64_t cpu_us, uint64_t total_cpu_us, int64_t utility_tokens) {
+      return static_cast<int64_t>(static_cast<uint128_t>(cpu_us) * static_cast<uint64_t>(utility_tokens) / total_cpu_us);
+    }
+
+    static checksum256 claim_leaf_hash(uint32_t index, name account, int64_t amount) {
+      auto packed = pack(claim_leaf{index, account, amount});
+      return sha256(packed.data(), packed.size());
+    }
+
+    // true if an account range overlaps one already distributed, only the range starting closest below last can
+    static bool range_distributed(const dataset_distribution_table& dist_t, name first, name last) {
+      auto idx = dist_t.get_index<"firstacct"_n>();
+      auto itr = idx.upper_bound(last.value);
+      if (itr == idx.begin()) return false;
+      itr--;
+      return itr->last_account >= first;
+    }
+
+    // accounts of an ordered dataset outside every range already distributed
+    // the ranges are disjoint, so an account needs at most one lookup of the range starting closest below it
+    static std::vector<metric> uncovered_accounts(const dataset_distribution_table& dist_t, const std::vector<metric>& dataset) {
+      auto idx = dist_t.get_index<"firstacct"_n>();
+      std::vector<metric> uncovered;
+      auto range = idx.end();
+      for (const auto& m : dataset) {
+        if (range == idx.end() || range->last_account < m.a) {
+          range = idx.upper_bound(m.a.value);
+          if (range == idx.begin()) {
+            range = idx.end();
+          } else {
+            range--;
+          }
+        }
+        if (range == idx.end() || range->last_account < m.a) {
+          uncovered.push_back(m);
+        }
+      }
+      return uncovered;
+    }
+
+    // clear the ranges lying between first and last, both outside every range, once a dataset spanning them is recorded
+    // the accounts they hold stay inside the new range, so the ranges are kept disjoint without losing coverage
+    static void absorb_ranges(dataset_distribution_table& dist_t, name first, name last) {
+      auto idx = dist_t.get_index<"firstacct"_n>();
+      auto itr = idx.lower_bound(first.value);
+      while (itr != idx.end() && itr->first_account <= last) {
+        auto next = itr;
+        next++;
+        idx.modify(itr, same_payer, [&](auto& t) {
+          t.first_account = name();
+          t.last_account = name();
+        });
+        itr = next;
+      }
+    }
+
+    // queue a dataset the oracles agreed on for distribute, the submitted data hashes to the consensus hash so it is the modal data
+    // claim roots cost one pass over the dataset without table writes so they are still built here
+    static void queue_dataset(name self, const std::vector<metric>& dataset, uint16_t dataset_id, const checksum256& hash, time_point_sec period_start,
+                              const resource_config_state& conf, uint64_t total_cpu, int64_t utility_tokens) {
+      // ordered datasets agreed on by different oracles could still cover the same accounts,
+      // only the accounts outside the ranges already paid out are paid from such a dataset
+      dataset_distribution_table dist_t(self, period_scope(period_start));
+      bool ordered = conf.dedupe_mode == 1 && !dataset.empty();
+      bool overlaps = ordered && range_distributed(dist_t, dataset.front().a, dataset.back().a);
+      std::vector<metric> uncovered;
+      if (overlaps) {
+        uncovered = uncovered_accounts(dist_t, dataset);
+        if (!uncovered.empty()) absorb_ranges(dist_t, uncovered.front().a, uncovered.back().a);
+      }
+      const auto& paid = overlaps ? uncovered : dataset;
+
+      if (conf.distribution_mode == 1) {
+        // one row per dataset, accounts redeem their leaf with claimproof
+        std::vector<checksum256> peaks;
+        uint32_t index = 0;
+        int64_t amount = 0;
+        for (const auto& m : paid) {
+          int64_t payout = usage_payout(m.u, total_cpu, utility_tokens);
+          merkle_append(peaks, index, claim_leaf_hash(index, m.a, payout));
+          amount += payout;
+          index++;
+        }
+        if (index > 0) {
+          claim_root_table cr_t(self, self.value);
+          cr_t.emplace(self, [&](auto& t) {
+            t.id = cr_t.available_primary_key();
+            t.period_start = period_start;
+            t.dataset_id = dataset_id;
+            t.leaf_count = index;
+            t.root = merkle_root(peaks);
+            t.claimed.resize((index + 7) / 8);
+            t.amount = amount;
+          });
+        }
+      }
+      dist_t.emplace(self, [&](auto& t) {
+        t.dataset_id = dataset_id;
+        if (ordered && !paid.empty()) {
+          t.first_account = paid.front().a;
+          t.last_account = paid.back().a;
+        }
+        t.hash = hash;
+        t.row_count = conf.distribution_mode == 1 ? 0 : paid.size();
+        if (overlaps && conf.distribution_mode == 0) t.rows = uncovered;
+      });
+    }
+
+    // accrue up to max_rows accounts of a queued dataset into resaccpay, resuming at next_row, and return how many were accrued
+    static uint32_t accrue_dataset(name self, const resource_config_state& conf, dataset_distribution_table& dist_t,
+                                   dataset_distribution_table::const_iterator dist_itr, uint32_t max_rows, symbol core_sym) {
+      datasets_table d_t(self, period_scope(conf.period_start));
+      const auto& dataset = dist_itr->rows.empty() ? d_t.get_index<"hash"_n>().get(dist_itr->hash, "consensus dataset not found").data : dist_itr->rows;
+
+      // the open period's inflation, issued before any of its datasets were queued
+      system_usage_history_table suh_t(oracle::system_account, oracle::system_account.value);
+      auto suh_itr = suh_t.end();
+      suh_itr--;
+      uint64_t total_cpu = suh_itr->total_cpu_us;
+      int64_t utility_tokens = suh_itr->utility_tokens.amount;
+
+      account_pay_table ap_t(self, self.value);
+      uint32_t end = std::min<uint32_t>(dist_itr->row_count, dist_itr->next_row + max_rows);
+
+      // datasets queued under dedupe_mode 1 ascend by account, so resaccpay is merged forward from one lower_bound
+      // instead of a find per row, the cursor always rests on the first row not below the current account
+      bool ordered = dist_itr->last_account != name();
+      auto ap_itr = ap_t.end();
+      if (ordered && dist_itr->next_row < end) ap_itr = ap_t.lower_bound(dataset[dist_itr->next_row].a.value);
+
+      for (uint32_t i = dist_itr->next_row; i < end; i++) {
+        const auto& m = dataset[i];
+        asset payout = asset(usage_payout(m.u, total_cpu, utility_tokens), core_sym);
+        if (!ordered) {
+          ap_itr = ap_t.find(m.a.value);
+        } else if (ap_itr != ap_t.end() && ap_itr->account < m.a) {
+          // the next row is usually the account wanted when the dataset is dense, otherwise seek past the gap
+          ap_itr++;
+          if (ap_itr != ap_t.end() && ap_itr->account < m.a) ap_itr = ap_t.lower_bound(m.a.value);
+        }
+
+        if (ap_itr == ap_t.end() || ap_itr->account != m.a) {
+          ap_t.emplace(self, [&](auto& t) {
+            t.account = m.a;
+            t.balance = payout;
+            t.timestamp = conf.period_start;
+          });
+        } else {
+          ap_t.modify(ap_itr, self, [&](auto& t) {
+            t.balance += payout;
+            t.timestamp = conf.period_start;
+          });
+        }
+      }
+
+      uint32_t accrued = end - dist_itr->next_row;
+      dist_t.modify(dist_itr, same_payer, [&](auto& t) {
+        t.next_row = end;
+      });
+      return accrued;
+    }
+
+    // accrue queued datasets nobody has called distribute for, within budget, and return whether all are done
+    static bool finish_distributions(name self, const resource_config_state& conf, uint32_t& budget, symbol core_sym) {
+      dataset_distribution_table dist_t(self, period_scope(conf.period_start));
+      auto pending_idx = dist_t.get_index<"pending"_n>();
+      for (auto itr = pending_idx.begin(); itr != pending_idx.end() && itr->by_pending() == 0; itr = pending_idx.begin()) {
+        if (budget == 0) return false;
+        budget -= accrue_dataset(self, conf, dist_t, dist_t.iterator_to(*itr), budget, core_sym);
+      }
+      return true;
+    }
+
+    // queue datasets of the open period which reached consensus while it was the next period, before its inflation was issued
+    // walks resconsensus from catchup_cursor, leaving stage 2 once every row has been checked
+    // each row visited costs one of the budget and a queued dataset its rows, read and in mode 1 hashed
+    // a dataset which does not fit what is left waits for the next step, one always fits a fresh step as addactusg queues it in one action
+    static void queue_pending(name self, resource_config_state& conf, uint32_t& budget) {
+      uint64_t scope = period_scope(conf.period_start);
+      consensus_table c_t(self, scope);
+      datasets_table d_t(self, scope);
+      auto dt_hash_index = d_t.get_index<"hash"_n>();
+      dataset_distribution_table dist_t(self, scope);
+
+      system_usage_history_table suh_t(oracle::system_account, oracle::system_account.value);
+      auto suh_itr = suh_t.end();
+      suh_itr--;
+
+      uint32_t spent = 0;
+      auto c_itr = c_t.lower_bound(conf.catchup_cursor);
+      while (c_itr != c_t.end() && spent < budget) {
+        uint32_t cost = 1;
+        if (c_itr->dataset_id > 0 && c_itr->count >= conf.oracle_consensus_threshold && dist_t.find(c_itr->dataset_id) == dist_t.end()) {
+          const auto& d = dt_hash_index.get(c_itr->hash, "consensus dataset not found");
+          cost += d.data.size();
+          if (spent > 0 && spent + cost > budget) break;
+          queue_dataset(self, d.data, c_itr->dataset_id, c_itr->hash, conf.period_start, conf, suh_itr->total_cpu_us, suh_itr->utility_tokens.amount);
+        }
+        spent += cost;
+        c_itr++;
+      }
+      if (c_itr == c_t.end()) {
+        conf.rollover_stage = 0;
+        conf.catchup_cursor = 0;
+      } else {
+        conf.catchup_cursor = c_itr->id;
+      }
+      budget -= std::min(budget, spent);
+    }
+
+    // RFC 9162 inclusion proof verification for leaf_index in a tree of tree_size leaves
+    static bool verify_inclusion(checksum256 hash, uint64_t leaf_index, uint64_t tree_size, const std::vector<checksum256>& proof, const checksum256& root) {
+      if (leaf_index >= tree_size) return false;
+      uint64_t fn = leaf_index;
+      uint64_t sn = tree_size - 1;
+      for (const auto& p : proof) {
+        if (sn == 0) return false;
+        if ((fn & 1) || fn == sn) {
+          hash = merkle_parent(p, hash);
+          if (!(fn & 1)) {
+            while (!(fn & 1) && fn != 0) {
+              fn >>= 1;
+              sn >>= 1;
+            }
+          }
+        } else {
+          hash = merkle_parent(hash, p);
+        }
+        fn >>= 1;
+        sn >>= 1;
+      }
+      return sn == 0 && hash == root;
+    }
+
+    // read one unsigned LEB128 value
+    static uint64_t read_varint(const char*& pos, const char* end) {
+      uint64_t value = 0;
+      for (uint32_t shift = 0; ; shift += 7) {
+        check(pos < end, "truncated usage payload");
+        uint8_t byte = static_cast<uint8_t>(*pos++);
+        check(shift < 63 || (shift == 63 && byte <= 1), "usage payload varint overflow");
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+      }
+    }
+
+    // decode an addactusgz payload in a single pass
+    static std::vector<metric> decode_dataset(const std::vector<char>& payload, uint16_t max_size) {
+      const char* pos = payload.data();
+      const char* end = pos + payload.size();
+
+      uint64_t count = read_varint(pos, end);
+      check(count <= max_size, "must supply fewer dataset values");
+
+      std::vector<metric> dataset(count);
+      uint64_t account = 0;
+      for (uint64_t i = 0; i < count; i++) {
+        uint64_t delta = read_varint(pos, end);
+        check(i == 0 || delta > 0, "usage payload accounts must be strictly ascending");
+        check(account + delta >= account, "usage payload account overflow");
+        account += delta;
+        dataset[i].a = name(account);
+        dataset[i].u = read_varint(pos, end);
+      }
+      check(pos == end, "unexpected data after usage payload");
+      return dataset;
+    }
+
+    // check if calling account is a qualified oracle
+    static bool is_oracle(const name owner){
+      auto oracles = system_contract::get_oracles();
+      return std::binary_search(oracles.begin(), oracles.end(), owner);
+    }
+
+    oracle::oracle( name s, name code, datastream<const char*> ds )
+    :contract(s, code, ds),
+     _resource_config(get_self(), get_self().value)
+    {
+    }
+
+    // called from settotalusg and nextperiod once the open period's totals reached consensus
+    // eosio.system writes the history row and issues the tokens in the inline issueinfl, which runs after this action,
+    // so datasets are only paid out from the next action on
+    void oracle::transfer_inflation(uint64_t total_cpu_us, uint64_t total_net_words, time_point_sec period_start) {
+        system_contract::issueinfl_action issueinfl_act{system_account, {{get_self(), active_permission}}};
+        issueinfl_act.send(total_cpu_us, total_net_words, period_start);
+
+        auto _resource_config_state = _resource_config.get();
+        _resource_config_state.inflation_transferred = true;
+
+        // datasets submitted while this was the next period may already have reached consensus, nextperiod pays them out
+        consensus_table c_t(get_self(), period_scope(period_start));
+        auto c_idx = c_t.get_index<"datasethash"_n>();
+        if (c_idx.lower_bound(consensus_key(1, checksum256())) != c_idx.end()) {
+            _resource_config_state.rollover_stage = 2;
+            _resource_config_state.catchup_cursor = 0;
+        }
+        _resource_config.set( _resource_config_state, get_self() );
+    }
+
+
+    // eosio.system must have been set up with initinfl, which writes the first usage history row
+    // on a chain which ran the oracle in eosio.system call this before its migrateres erases the old resourceconf
+    ACTION oracle::initresource(uint16_t dataset_batch_size, uint16_t oracle_consensus_threshold, time_point_sec period_start, uint32_t period_seconds)
+    {
+        require_auth(get_self());
+
+        system_usage_history_table u_t(system_account, system_account.value);
+        check(u_t.begin() != u_t.end(), "eosio.system inflation not initialised");
+
+        // oracles moving over from eosio.system keep the hash format and payout settings they were using there
+        resource_config_state defaults{};
+        legacy_resource_config_singleton legacy(system_account, system_account.value);
+        if (legacy.exists()) {
+            auto legacy_state = legacy.get();
+            defaults.hash_version = *legacy_state.hash_version;
+            defaults.distribution_mode = *legacy_state.distribution_mode;
+            defaults.dedupe_mode = *legacy_state.dedupe_mode;
+            defaults.claim_expiry_seconds = *legacy_state.claim_expiry_seconds;
+            defaults.sweep_account = *legacy_state.sweep_account;
+        }
+
+        auto _resource_config_state = _resource_config.get_or_create(_self, defaults);
+        _resource_config_state.dataset_batch_size = dataset_batch_size;
+        _resource_config_state.oracle_consensus_threshold = oracle_consensus_threshold;
+        _resource_config_state.period_start = period_start;
+        _resource_config_state.period_seconds = period_seconds;
+        _resource_config_state.active = false;
+
+        // only remove submission state if no inflation has been issued yet
+        auto u_itr = u_t.end();
+        u_itr--;
+        if (u_itr->daycount == 0) {
+            _resource_config_state.inflation_transferred = false;
+        }
+
+        // a period eosio.system already issued inflation for carries on here, the datasets it distributed are settled
+        // so that no resubmission of them is paid again
+        if (legacy.exists() && legacy.get().period_start == period_start && legacy.get().inflation_transferred) {
+            _resource_config_state.inflation_transferred = true;
+            dataset_distribution_table dist_t(get_self(), period_scope(period_start));
+            auto settle = [&](uint16_t dataset_id, name first_account, name last_account) {
+                if (dist_t.find(dataset_id) == dist_t.end()) {
+                    dist_t.emplace(get_self(), [&](auto& t) {
+                        t.dataset_id = dataset_id;
+                        t.first_account = first_account;
+                        t.last_account = last_account;
+                    });
+                }
+            };
+            for (auto dataset_id : legacy.get().account_distributions_made) {
+                settle(dataset_id, name(), name());
+            }
+            // resdistrib was scoped by eosio before the period tables were scoped by period
+            for (uint64_t scope : {system_account.value, period_scope(period_start)}) {
+                legacy_dataset_distribution_table legacy_dist(system_account, scope);
+                for (const auto& d : legacy_dist) {
+                    settle(d.dataset_id, *d.first_account, *d.last_account);
+                }
+            }
+        }
+        _resource_config.set( _resource_config_state, get_self() );
+    }
+
+    // sets total resources used by system (for calling oracle)
+    // this must be called by oracle before adding individual cpu usage
+    ACTION oracle::settotalusg(name source, uint64_t total_cpu_us, uint64_t total_net_words, checksum256 all_data_hash, time_point_sec period_start)
+    {
+        require_auth(source);
+        check(is_oracle(source) == true, "not a qualified oracle");
+
+        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
+
+        check(_resource_config_state.active, "resource model not active");
+        bool current = check_period(_resource_config_state, period_start);
+
+        // check submissions are within system limits
+        const auto gstate = global_state_singleton(system_account, system_account.value).get();
+        uint64_t system_max_cpu = static_cast<uint64_t>(gstate.max_block_cpu_usage) * 2 * 60 * 60 * 24;
+        check( total_cpu_us <= system_max_cpu, "measured cpu usage is greater than system total");
+        uint64_t system_max_net = static_cast<uint64_t>(gstate.max_block_net_usage) * 2 * 60 * 60 * 24;
+        check( total_net_words * 8 <= system_max_net, "measured net usage is greater than system total");
+
+        system_usage_table u_t(get_self(), period_scope(period_start));
+        auto itr = u_t.find(source.value);
+
+        check(itr == u_t.end(), "total already set");
+
+        // hash submitted data
+        checksum256 hash = hash_totals(total_cpu_us, total_net_words, _resource_config_state.hash_version);
+
+        // add totals data
+        u_t.emplace(source, [&](auto& t) {
+            t.source = source;
+            t.total_cpu_us = total_cpu_us;
+            t.total_net_words = total_net_words;
+            t.submission_count = 1;
+            merkle_append(t.merkle_peaks, 0, hash);
+            t.all_data_hash = all_data_hash;
+        });
+
+        // distribute inflation once enough oracles agree on the open period's totals, the next period's are checked by nextperiod
+        uint16_t votes = add_consensus_vote(get_self(), period_scope(period_start), 0, hash);
+        if (current && !_resource_config_state.inflation_transferred && votes >= _resource_config_state.oracle_consensus_threshold) {
+            transfer_inflation(total_cpu_us, total_net_words, period_start);
+        }
+    }
+
+    // adds the CPU used by the accounts included (for calling oracle)
+    // called after the oracle has set the total
+    ACTION oracle::addactusg(name source, uint16_t dataset_id, const std::vector<metric>& dataset, time_point_sec period_start)
+    {  
+        require_auth(source);
+        add_usage_datasets(source, dataset_id, {dataset}, {}, period_start);
+    }
+
+    // same as addactusg with the dataset encoded as a LEB128 count followed by, per account in ascending
+    // name order, the LEB128 difference from the previous name value and the LEB128 cpu usage
+    // decodes to the same metrics, so the hash matches a plain submission of the sorted dataset
+    ACTION oracle::addactusgz(name source, uint16_t dataset_id, const std::vector<char>& payload, time_point_sec period_start)
+    {
+        require_auth(source);
+        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
+        add_usage_datasets(source, dataset_id, {decode_dataset(payload, _resource_config_state.dataset_batch_size)}, {}, period_start);
+    }
+
+    // consecutive datasets starting at first_dataset_id, each handled as its own addactusg
+    ACTION oracle::addactusgm(name source, uint16_t first_dataset_id, const std::vector<std::vector<metric>>& datasets, time_point_sec period_start)
+    {
+        require_auth(source);
+        check(!datasets.empty(), "must supply at least one dataset");
+        add_usage_datasets(source, first_dataset_id, datasets, {}, period_start);
+    }
+
+    // same as addactusg for a dataset another oracle has already uploaded this period, identified by its hash
+    // the stored body is checked against this oracle's totals and order, only the hash travels with the action
+    ACTION oracle::voteactusg(name source, uint16_t dataset_id, checksum256 hash, time_point_sec period_start)
+    {
+        require_auth(source);
+        add_usage_datasets(source, dataset_id, {}, {hash}, period_start);
+    }
+
+    // called from addactusg, addactusgz, addactusgm and voteactusg, with either dataset bodies or hashes of stored ones
+    // oracle, period and row lookups happen once per action however many datasets are submitted
+    // the config singleton is only read, distribution state is kept per dataset in resdistrib
+    // datasets for the next period are stored and voted on only, nextperiod pays out those agreed on once it has advanced
+    void oracle::add_usage_datasets(name source, uint16_t first_dataset_id, const std::vector<std::vector<metric>>& datasets, const std::vector<checksum256>& hashes, time_point_sec period_start)
+    {
+        check(is_oracle(source) == true, "not a qualified oracle");
+
+        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
+
+        check(_resource_config_state.active, "resource model not active");
+        bool current = check_period(_resource_config_state, period_start);
+
+        check(!current || _resource_config_state.inflation_transferred == true, "inflation not yet transferred");
+
+        uint64_t scope = period_scope(period_start);
+        system_usage_table u_t(get_self(), scope);
+        auto ut_itr = u_t.find(source.value);
+        check(ut_itr != u_t.end(), "usage totals not set");
+        check(first_dataset_id == ut_itr->submission_count, "dataset_id differs from expected value");
+        size_t count = hashes.empty() ? datasets.size() : hashes.size();
+        check(static_cast<uint32_t>(first_dataset_id) + count <= std::numeric_limits<uint16_t>::max(), "too many datasets");
+
+        uint64_t unallocated_cpu = ut_itr->total_cpu_us - ut_itr->allocated_cpu;
+        uint64_t allocated_cpu = 0;
+        std::vector<checksum256> merkle_peaks = ut_itr->merkle_peaks;
+        uint16_t submission_count = ut_itr->submission_count;
+        bool ordered = _resource_config_state.dedupe_mode == 1;
+        name last_account = ut_itr->last_account;
+
+        datasets_table d_t(get_self(), scope);
+        auto dt_hash_index = d_t.get_index<"hash"_n>();
+        dataset_distribution_table dist_t(get_self(), scope);
+
+        // get total_cpu from the last eosio.system usage history record
+        system_usage_history_table suh_t(system_account, system_account.value);
+        auto suh_itr = suh_t.end();
+        suh_itr--;
+        auto total_cpu = suh_itr->total_cpu_us;
+        auto utility_tokens_amount = suh_itr->utility_tokens.amount;
+
+        for (size_t i = 0; i < count; i++) {
+            uint16_t dataset_id = submission_count;
+            // a vote uses the body stored under its hash, which passed the batch size check when it was uploaded
+            bool vote = !hashes.empty();
+            const std::vector<metric>& dataset = vote ? dt_hash_index.get(hashes[i], "dataset not found").data : datasets[i];
+            check(vote || dataset.size() <= _resource_config_state.dataset_batch_size, "must supply fewer dataset values");
+
+            // validate usage and check the oracle does not exceed its declared total
+            // ordered submissions continue from the oracle's last account, one comparison per row rules out duplicates
+            for (const auto& m : dataset) {
+                check(m.u > 0, "account cpu measurement must be greater than 0");
+                if (ordered) {
+                    check(m.a > last_account, "duplicate or unordered account in usage data");
+                    last_account = m.a;
+                }
+                check(unallocated_cpu - allocated_cpu >= m.u, "insufficient unallocated cpu");
+                allocated_cpu += m.u;
+            }
+
+            // hash submitted dataset
+            checksum256 hash = vote ? hashes[i] : hash_dataset(dataset, _resource_config_state.hash_version);
+            merkle_append(merkle_peaks, submission_count, hash);
+            submission_count++;
+
+            // once a dataset has settled a differing body is committed to but neither stored nor counted
+            checksum256 settled_hash;
+            bool settled = find_settled_hash(get_self(), scope, dist_t, dataset_id, _resource_config_state, settled_hash);
+            if (settled && settled_hash != hash) continue;
+
+            // add data and hash to table if not already present, each dataset voting for a body holds a reference to it
+            // a body is only erased with its last vote, so a missing body has no vote for this dataset yet
+            auto dt_itr = dt_hash_index.find(hash);
+            uint16_t votes = add_consensus_vote(get_self(), scope, dataset_id, hash);
+            if (dt_itr == dt_hash_index.end()) {
+                d_t.emplace(source, [&](auto& t) {
+                    t.id = d_t.available_primary_key();
+                    t.hash = hash;
+                    t.data = dataset;
+                    t.refs = 1;
+                });
+            } else if (votes == 1) {
+                dt_hash_index.modify(dt_itr, same_payer, [&](auto& t) {
+                    t.refs++;
+                });
+            }
+
+            // queue user account rewards for distribute once enough oracles agree on this dataset, the bodies which lost are dropped
+            if (!settled && votes >= _resource_config_state.oracle_consensus_threshold) {
+                if (current) {
+                    queue_dataset(get_self(), dataset, dataset_id, hash, period_start, _resource_config_state, total_cpu, utility_tokens_amount);
+                }
+                drop_losing_datasets(get_self(), scope, d_t, dataset_id, hash);
+            }
+        }
+
+        u_t.modify(ut_itr, source, [&](auto& t) {
+            t.allocated_cpu += allocated_cpu;
+            t.merkle_peaks = std::move(merkle_peaks);
+            t.submission_count = submission_count;
+            t.last_account = last_account;
+        });
+    }
+
+    // one bounded step of the period rollover, shared by nextperiod and the rollover action eosio.system schedules from onblock
+    // the first step scores the oracles, then each step clears at most budget period rows
+    // the period start only advances on the step which clears the last row, the next period's inflation is issued
+    // there if its totals already reached consensus and its datasets agreed on are then queued, each charged its rows
+    // datasets queued but not yet fully distributed are accrued before the period rows are cleared
+    // returns why the period cannot roll over yet, before anything is written for it, or nullptr
+    const char* oracle::rollover_step(uint32_t budget)
+    {
+        auto _resource_config_state = _resource_config.get();
+        bool period_ended = current_time_point().sec_since_epoch() >= _resource_config_state.period_start.sec_since_epoch() + _resource_config_state.period_seconds;
+
+        if (_resource_config_state.rollover_stage == 2) {
+            queue_pending(get_self(), _resource_config_state, budget);
+            if (_resource_config_state.rollover_stage == 2 || budget == 0 || !period_ended) {
+                _resource_config.set( _resource_config_state, get_self() );
+                return nullptr;
+            }
+        }
+
+        time_point_sec period_start = _resource_config_state.period_start;
+        system_usage_table u_t(get_self(), period_scope(period_start));
+
+        if (_resource_config_state.rollover_stage == 0) {
+            if (!period_ended) return "current resource period has not ended";
+
+            // accounts of queued datasets are paid before the period's distribution rows are cleared
+            if (!finish_distributions(get_self(), _resource_config_state, budget, system_contract::get_core_symbol())) {
+                _resource_config.set( _resource_config_state, get_self() );
+                return nullptr;
+            }
+
+            // find modal all_data_hash, bounded by the number of oracles which submitted totals
+            std::map<checksum256, uint8_t> hash_count;
+            checksum256 modal_hash;
+            uint8_t mode_count = 0;
+            for (auto ut_itr = u_t.begin(); ut_itr != u_t.end(); ut_itr++) {
+                hash_count[ut_itr->all_data_hash]++;
+            }
+            for (auto const& x : hash_count) {
+                if (x.second > mode_count) {
+                    modal_hash = x.first;
+                    mode_count = x.second;
+                }
+            }
+
+            // score submissions based on commitment hash and modal agreement
+            std::vector<std::pair<name, uint64_t>> scores;
+            auto oracle_full_data_mode_count = 0;
+            if (mode_count >= _resource_config_state.oracle_consensus_threshold) {
+                for (auto ut_itr = u_t.begin(); ut_itr != u_t.end(); ut_itr++) {
+                    uint64_t oracle_points = 0;
+                    checksum256 commit_hash = ut_itr->all_data_hash;
+                    checksum256 reveal_hash = merkle_root(ut_itr->merkle_peaks);
+                    if (reveal_hash == commit_hash) {
+                        oracle_points = 1; // data is as declared
+                        if (commit_hash == modal_hash) {
+                            oracle_points += 9; // data is same as modal data
+                            oracle_full_data_mode_count += 1;
+                        }
+                    }
+                    scores.emplace_back(ut_itr->source, oracle_points);
+                }
+            }
+
+            // prevent period advancing if no modal data was received, the scores are only written once it can
+            if (oracle_full_data_mode_count < _resource_config_state.oracle_consensus_threshold) return "full modal data not received";
+
+            // add/modify score in sources table
+            sources_table s_t(get_self(), get_self().value);
+            for (const auto& score : scores) {
+                auto st_itr = s_t.find(score.first.value);
+                if (st_itr == s_t.end()) {
+                    s_t.emplace(get_self(), [&](auto& t) {
+                        t.account = score.first;
+                        t.submissions_score = score.second;
+                        t.submissions_count = 1;
+                    });
+                } else {
+                    s_t.modify(st_itr, get_self(), [&](auto& t) {
+                        t.submissions_score += score.second;
+                        t.submissions_count += 1;
+                    });
+                }
+
+                // todo - add oracle payment in future version
+            }
+
+            // submissions stay closed until the cleanup below has finished
+            _resource_config_state.rollover_stage = 1;
+        }
+
+        // erase the period's records, oldest first so each step resumes where the last stopped
+        datasets_table d_t(get_self(), period_scope(period_start));
+        budget -= erase_rows(d_t, budget);
+        consensus_table c_t(get_self(), period_scope(period_start));
+        budget -= erase_rows(c_t, budget);
+        dataset_distribution_table dist_t(get_self(), period_scope(period_start));
+        budget -= erase_rows(dist_t, budget);
+        budget -= erase_rows(u_t, budget);
+
+        if (d_t.begin() == d_t.end() && c_t.begin() == c_t.end() && dist_t.begin() == dist_t.end() && u_t.begin() == u_t.end()) {
+            _resource_config_state.period_start = time_point_sec(period_start.sec_since_epoch() + _resource_config_state.period_seconds);
+            _resource_config_state.inflation_transferred = false;
+            _resource_config_state.rollover_stage = 0;
+            _resource_config.set( _resource_config_state, get_self() );
+
+            // oracles may have agreed on the new period's totals while it was the next period
+            // the inflation is issued after this action, so its agreed datasets are queued by the following steps
+            uint64_t total_cpu_us, total_net_words;
+            if (find_total_consensus(get_self(), _resource_config_state.period_start, _resource_config_state.oracle_consensus_threshold,
+                                     _resource_config_state.hash_version, total_cpu_us, total_net_words)) {
+                transfer_inflation(total_cpu_us, total_net_words, _resource_config_state.period_start);
+                _resource_config_state = _resource_config.get();
+            }
+        }
+
+        _resource_config.set( _resource_config_state, get_self() );
+        return nullptr;
+    }
+
+    // called by anyone once the current period has ended, see rollover_step
+    ACTION oracle::nextperiod(uint16_t max_rows)
+    {
+        check(max_rows > 0, "max_rows must be greater than 0");
+
+        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
+
+        check(_resource_config_state.active, "resource model not active");
+
+        const char* error = rollover_step(max_rows);
+        if (error != nullptr) check(false, error);
+    }
+
+    // scheduled by eosio.system from onblock with its per step budget while the period has ended or a rollover is under way
+    // unlike nextperiod it returns quietly when the period cannot roll over yet, so the waiting steps do not fail
+    ACTION oracle::rollover(uint16_t max_rows)
+    {
+        require_auth(system_account);
+
+        if (max_rows == 0 || !_resource_config.exists() || !_resource_config.get().active) return;
+        rollover_step(max_rows);
+    }
+
+    // called by anyone to pay the accounts of a dataset the oracles agreed on, at most max_rows per call
+    // datasets are independent so their slices can be pushed in parallel transactions
+    ACTION oracle::distribute(uint16_t dataset_id, uint16_t max_rows)
+    {
+        check(max_rows > 0, "max_rows must be greater than 0");
+
+        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
+
+        check(_resource_config_state.active, "resource model not active");
+        check(_resource_config_state.rollover_stage != 1, "period rollover in progress");
+
+        dataset_distribution_table dist_t(get_self(), period_scope(_resource_config_state.period_start));
+        auto dist_itr = dist_t.find(dataset_id);
+        check(dist_itr != dist_t.end(), "dataset not ready");
+        check(dist_itr->next_row < dist_itr->row_count, "dataset already distributed");
+
+        accrue_dataset(get_self(), _resource_config_state, dist_t, dist_itr, max_rows, system_contract::get_core_symbol());
+    }
+
+    // called by individual accounts to claim their distribution
+    ACTION oracle::claimdistrib(name account)
+    {
+        require_auth(account);
+
+        account_pay_table a_t(get_self(), get_self().value);
+        auto itr = a_t.find(account.value);
+        check(itr != a_t.end(), "account balance not found");
+        check(itr->balance != asset( 0, system_contract::get_core_symbol() ), "no balance to claim");
+
+        token::transfer_action transfer_act{token_account, {{upay_account, active_permission}, {account, active_permission}}};
+        transfer_act.send(upay_account, account, itr->balance, "utility reward");
+        itr = a_t.erase(itr);
+    }
+
+    // claimdistrib for many accounts, each authorising through a permission linked to claimmany so a relayer can pay them out
+    // the transfers only carry eosio.upay's authority as the accounts' active permission is not part of the action
+    ACTION oracle::claimmany(const std::vector<name>& accounts)
+    {
+        check(!accounts.empty(), "must supply at least one account");
+
+        account_pay_table a_t(get_self(), get_self().value);
+        const asset zero = asset( 0, system_contract::get_core_symbol() );
+        token::transfer_action transfer_act{token_account, {{upay_account, active_permission}}};
+
+        // each account is paid once however often it is listed
+        std::vector<name> unique_accounts = accounts;
+        std::sort(unique_accounts.begin(), unique_accounts.end());
+        unique_accounts.erase(std::unique(unique_accounts.begin(), unique_accounts.end()), unique_accounts.end());
+
+        // accounts already claimed or never paid are skipped, so one stale entry does not fail the relayer's batch
+        for (const auto& account : unique_accounts) {
+            require_auth(account);
+
+            auto itr = a_t.find(account.value);
+            if (itr == a_t.end() || itr->balance == zero) {
+                continue;
+            }
+
+            transfer_act.send(upay_account, account, itr->balance, "utility reward");
+            a_t.erase(itr);
+        }
+    }
+
+    // pay one leaf of a dataset's claim tree to its account
+    ACTION oracle::claimproof(name account, time_point_sec period_start, uint16_t dataset_id, uint32_t leaf_index, asset amount, const std::vector<checksum256>& proof)
+    {
+        require_auth(account);
+
+        claim_root_table cr_t(get_self(), get_self().value);
+        auto cr_idx = cr_t.get_index<"perioddata"_n>();
+        auto itr = cr_idx.find((static_cast<uint128_t>(period_start.sec_since_epoch()) << 64) | dataset_id);
+        check(itr != cr_idx.end(), "claim root not found");
+        check(leaf_index < itr->leaf_count, "leaf index out of range");
+        check((itr->claimed[leaf_index / 8] & (1 << (leaf_index % 8))) == 0, "already claimed");
+        check(amount.symbol == system_contract::get_core_symbol(), "symbol precision mismatch");
+        check(verify_inclusion(claim_leaf_hash(leaf_index, account, amount.amount), leaf_index, itr->leaf_count, proof, itr->root), "invalid claim proof");
+
+        cr_idx.modify(itr, same_payer, [&](auto& t) {
+            t.claimed[leaf_index / 8] |= (1 << (leaf_index % 8));
+            t.claimed_amount += amount.amount;
+        });
+
+        if (amount.amount > 0) {
+            token::transfer_action transfer_act{token_account, {{upay_account, active_permission}, {account, active_permission}}};
+            transfer_act.send(upay_account, account, amount, "utility reward");
+        }
+    }
+
+    // set how long a resaccpay balance stays claimable after its last payout, and a claim root after its period started,
+    // and where sweepclaims sends what is left afterwards
+    ACTION oracle::setclaimexp(uint32_t claim_expiry_seconds, name sweep_account) {
+        require_auth(get_self());
+
+        check(is_account(sweep_account), "sweep account does not exist");
+
+        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
+
+        _resource_config_state.claim_expiry_seconds = claim_expiry_seconds;
+        _resource_config_state.sweep_account = sweep_account;
+        _resource_config.set( _resource_config_state, get_self() );
+    }
+
+    // called by anyone to remove up to max_rows expired resaccpay balances, oldest payout first, then expired claim roots
+    // the funds left unclaimed go from eosio.upay to the sweep account and the RAM of each row is released
+    ACTION oracle::sweepclaims(uint16_t max_rows)
+    {
+        check(max_rows > 0, "max_rows must be greater than 0");
+
+        check(_resource_config.exists(), "resource model not initialised");
+        auto _resource_config_state = _resource_config.get();
+        check(_resource_config_state.claim_expiry_seconds > 0, "claim expiry not enabled");
+
+        uint64_t now = current_time_point().sec_since_epoch();
+        account_pay_table a_t(get_self(), get_self().value);
+        auto a_idx = a_t.get_index<"expiry"_n>();
+        asset swept = asset( 0, system_contract::get_core_symbol() );
+        uint16_t erased = 0;
+        auto itr = a_idx.begin();
+        while (itr != a_idx.end() && erased < max_rows && itr->by_timestamp() + _resource_config_state.claim_expiry_seconds <= now) {
+            swept += itr->balance;
+            itr = a_idx.erase(itr);
+            erased++;
+        }
+
+        // roots sort by period, so the expired ones come first
+        claim_root_table cr_t(get_self(), get_self().value);
+        auto cr_idx = cr_t.get_index<"perioddata"_n>();
+        auto cr_itr = cr_idx.begin();
+        while (cr_itr != cr_idx.end() && erased < max_rows && cr_itr->period_start.sec_since_epoch() + _resource_config_state.claim_expiry_seconds <= now) {
+            swept.amount += cr_itr->amount - cr_itr->claimed_amount;
+            cr_itr = cr_idx.erase(cr_itr);
+            erased++;
+        }
+        check(erased > 0, "no expired balances");
+
+        if (swept.amount > 0 && _resource_config_state.sweep_account != upay_account) {
+            token::transfer_action transfer_act{token_account, {{upay_account, active_permission}}};
+            transfer_act.send(upay_account, _resource_config_state.sweep_account, swept, "expired utility rewards");
+        }
+    }
+
+    // select how consensus datasets are paid out, only between periods
+    ACTION oracle::setdistmode(uint8_t distribution_mode) {
+        require_auth(get_self());
+
+        check(distribution_mode <= 1, "unsupported distribution mode");
+
+        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
+        check(!submissions_open(get_self(), _resource_config_state), "cannot change distribution mode while submissions are open");
+
+        _resource_config_state.distribution_mode = distribution_mode;
+        _resource_config.set( _resource_config_state, get_self() );
+    }
+
+    // require ordered datasets so duplicate accounts are rejected, only between periods
+    ACTION oracle::setdedupe(uint8_t dedupe_mode) {
+        require_auth(get_self());
+
+        check(dedupe_mode <= 1, "unsupported dedupe mode");
+
+        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
+        check(!submissions_open(get_self(), _resource_config_state), "cannot change dedupe mode while submissions are open");
+
+        _resource_config_state.dedupe_mode = dedupe_mode;
+        _resource_config.set( _resource_config_state, get_self() );
+    }
+
+    // activate/deactivate resource model inflation
+    ACTION oracle::resactivate(bool active) {
+        require_auth(get_self());
+
+        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
+
+        // check active state isn't already as requested
+        if (active) {
+            check(!_resource_config_state.active, "resource model already active");
+        } else {
+            check(_resource_config_state.active, "resource model already inactive");
+        }
+
+        _resource_config_state.active = active;
+        _resource_config.set( _resource_config_state, get_self() );
+    }
+
+    // select the dataset hash format, only between periods so all oracles hash alike
+    ACTION oracle::sethashver(uint8_t hash_version) {
+        require_auth(get_self());
+
+        check(hash_version <= 1, "unsupported hash version");
+
+        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
+        check(!submissions_open(get_self(), _resource_config_state), "cannot change hash version while submissions are open");
+
+        _resource_config_state.hash_version = hash_version;
+        _resource_config.set( _resource_config_state, get_self() );
+    }
+
+    // add the oracle scores and unclaimed balances eosio.system held before eosio.oracle, sent by its migrateres
+    ACTION oracle::importres(const std::vector<sources>& scores, const std::vector<account_pay>& pays) {
+        require_auth(system_account);
+
+        sources_table s_t(get_self(), get_self().value);
+        for (const auto& score : scores) {
+            auto itr = s_t.find(score.account.value);
+            if (itr == s_t.end()) {
+                s_t.emplace(get_self(), [&](auto& t) {
+                    t = score;
+                });
+            } else {
+                s_t.modify(itr, same_payer, [&](auto& t) {
+                    t.submissions_score += score.submissions_score;
+                    t.submissions_count += score.submissions_count;
+                });
+            }
+        }
+
+        account_pay_table a_t(get_self(), get_self().value);
+        for (const auto& pay : pays) {
+            auto itr = a_t.find(pay.account.value);
+            if (itr == a_t.end()) {
+                a_t.emplace(get_self(), [&](auto& t) {
+                    t = pay;
+                });
+            } else {
+                a_t.modify(itr, same_payer, [&](auto& t) {
+                    t.balance += pay.balance;
+                    t.timestamp = std::max(t.timestamp, pay.timestamp);
+                });
+            }
+        }
+    }
+
+    #ifdef INCLUDECLEARACTIONS
+        ACTION oracle::clrresource() {
+            require_auth(get_self());
+
+            auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
+            check(!_resource_config_state.active, "must deactivate before clearing");
+
+            account_pay_table a_t(get_self(), get_self().value);
+            auto a_itr = a_t.begin();
+            while (a_itr != a_t.end()) {
+                a_itr = a_t.erase(a_itr);
+            }
+
+            sources_table s_t(get_self(), get_self().value);
+            auto s_itr = s_t.begin();
+            while (s_itr != s_t.end()) {
+                s_itr = s_t.erase(s_itr);
+            }
+
+            claim_root_table cr_t(get_self(), get_self().value);
+            auto cr_itr = cr_t.begin();
+            while (cr_itr != cr_t.end()) {
+                cr_itr = cr_t.erase(cr_itr);
+            }
+
+            // period scoped tables of the open and the next period
+            uint64_t scope = period_scope(_resource_config_state.period_start);
+            for (uint64_t period : {scope, scope + _resource_config_state.period_seconds}) {
+                datasets_table d_t(get_self(), period);
+                erase_rows(d_t, std::numeric_limits<uint32_t>::max());
+                system_usage_table u_t(get_self(), period);
+                erase_rows(u_t, std::numeric_limits<uint32_t>::max());
+                consensus_table c_t(get_self(), period);
+                erase_rows(c_t, std::numeric_limits<uint32_t>::max());
+                dataset_distribution_table dist_t(get_self(), period);
+                erase_rows(dist_t, std::numeric_limits<uint32_t>::max());
+            }
+
+            if (_resource_config.exists()) _resource_config.remove();
+        }
+    #endif
+
+}
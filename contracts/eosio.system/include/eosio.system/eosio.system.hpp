@@ -14,6 +14,7 @@
 #include <eosio.system/producer_pay.hpp>
 #include <eosio.system/resource.hpp>
 
+#include <algorithm>
 #include <deque>
 #include <optional>
 #include <string>
@@ -75,6 +76,7 @@ namespace eosiosystem {
    static constexpr int64_t  ram_gift_bytes        = 0;
    static constexpr int64_t  min_pervote_daily_pay = 100'0000;
    static constexpr uint32_t refund_delay_sec      = 3 * seconds_per_day;
+   static constexpr uint32_t max_rollover_interval = 10 * 60; // longest wait between onblock rollover steps of an ended period
 
    static constexpr int64_t  inflation_precision           = 100;     // 2 decimals
    static constexpr int64_t  default_annual_rate           = 500;     // 5% annual rate
@@ -552,7 +554,7 @@ namespace eosiosystem {
          rex_order_table          _rexorders;
 
          producer_pay_table       _producer_pay;
-         resource_config_singleton _resource_config;
+         inflation_config_singleton _inflation_config;
 
       public:
          static constexpr eosio::name active_permission{"active"_n};
@@ -567,6 +569,7 @@ namespace eosiosystem {
          static constexpr eosio::name saving_account{"eosio.saving"_n};
          static constexpr eosio::name rex_account{"eosio.rex"_n};
          static constexpr eosio::name null_account{"eosio.null"_n};
+         static constexpr eosio::name oracle_account{"eosio.oracle"_n};
          static constexpr symbol ramcore_symbol = symbol(symbol_code("UTXRAM"), 4);
          static constexpr symbol ram_symbol     = symbol(symbol_code("RAM"), 0);
          static constexpr symbol rex_symbol     = symbol(symbol_code("REX"), 4);
@@ -582,6 +585,23 @@ namespace eosiosystem {
             return sym;
          }
 
+          // Returns the producers of the last proposed schedule, sorted by name, who act as resource oracles
+          // falls back to the vote index until update_elected_producers has written the cache
+          // @param system_account - the system account holding the producer tables.
+         static std::vector<name> get_oracles( name system_account = "eosio"_n ) {
+            oracle_set_singleton oracle_cache(system_account, system_account.value);
+            if (oracle_cache.exists()) return oracle_cache.get().oracles;
+
+            std::vector<name> oracles;
+            producers_table ptable(system_account, system_account.value);
+            auto p_idx = ptable.get_index<"prototalvote"_n>();
+            for (auto p_itr = p_idx.cbegin(); p_itr != p_idx.cend() && oracles.size() < 21 && 0 < p_itr->total_votes && p_itr->active(); ++p_itr) {
+               oracles.emplace_back(p_itr->owner);
+            }
+            std::sort(oracles.begin(), oracles.end());
+            return oracles;
+         }
+
          // Actions:
          /**
           * The Init action initializes the system contract for a version and a symbol.
@@ -1182,13 +1202,12 @@ namespace eosiosystem {
          [[eosio::action]]
          void setinflation( int64_t annual_rate, int64_t inflation_pay_factor, int64_t votepay_factor );
 
-         // resource actions defined in resource.cpp
-         ACTION initresource(uint16_t dataset_batch_size, uint16_t oracle_consensus_threshold, time_point_sec period_start, uint32_t period_seconds, double initial_value_transfer_rate, double max_pay_constant);
-         ACTION settotalusg(name source, uint64_t total_cpu_us, uint64_t total_net_words, checksum256 all_data_hash, time_point_sec period_start);
-         ACTION addactusg(name source, uint16_t dataset_id, const std::vector<metric>& dataset, time_point_sec period_start);
-         ACTION nextperiod();
-         ACTION claimdistrib(name account);
-         ACTION resactivate(bool active);
+         // resource inflation actions defined in resource.cpp, usage is reported to the eosio.oracle contract which calls issueinfl
+         ACTION initinfl(time_point_sec period_start, double initial_value_transfer_rate, double max_pay_constant);
+         ACTION issueinfl(uint64_t total_cpu_us, uint64_t total_net_words, time_point_sec period_start);
+         ACTION setdraglimit(uint32_t emadraglimit);
+         ACTION setrollover(uint16_t rollover_rows);
+         ACTION migrateres(uint16_t max_rows);
          #ifdef INCLUDECLEARACTIONS
             ACTION clrresource();
          #endif
@@ -1196,6 +1215,7 @@ namespace eosiosystem {
           // resource helper functions defined in resource.cpp
          void set_total(uint64_t total_cpu_us, uint64_t total_net_words, time_point_sec period_start);
          void issue_inflation(time_point_sec period_start);
+         void step_oracle_rollover();
 
          /**
           * limitauthchg opts into or out of restrictions on updateauth, deleteauth, linkauth, and unlinkauth.
@@ -1261,6 +1281,7 @@ namespace eosiosystem {
          using setalimits_action = eosio::action_wrapper<"setalimits"_n, &system_contract::setalimits>;
          using setparams_action = eosio::action_wrapper<"setparams"_n, &system_contract::setparams>;
          using setinflation_action = eosio::action_wrapper<"setinflation"_n, &system_contract::setinflation>;
+         using issueinfl_action = eosio::action_wrapper<"issueinfl"_n, &system_contract::issueinfl>;
 
       private:
          // Implementation details:
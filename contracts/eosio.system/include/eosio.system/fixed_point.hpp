@@ -0,0 +1,305 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace ux {
+
+   // signed Q64.64 fixed point, 64 integer bits and 64 fraction bits in a 128 bit integer
+   // every operation is plain integer arithmetic so results are identical on every node and
+   // do not go through the softfloat library; products and quotients truncate toward zero
+   class fixed {
+   public:
+      using raw_type = __int128;
+      using uraw_type = unsigned __int128;
+
+      static constexpr uraw_type one_raw = static_cast<uraw_type>(1) << 64;
+
+      raw_type raw = 0;
+
+      constexpr fixed() = default;
+
+      static constexpr fixed from_raw(raw_type r) {
+         fixed f;
+         f.raw = r;
+         return f;
+      }
+
+      static constexpr fixed from_int(int64_t v) {
+         return from_raw(static_cast<raw_type>(v) * static_cast<raw_type>(one_raw));
+      }
+
+      // num / den with full fraction precision, den must not be zero
+      static constexpr fixed from_ratio(uint64_t num, uint64_t den) {
+         return from_raw(static_cast<raw_type>((static_cast<uraw_type>(num) << 64) / den));
+      }
+
+      // exact for the 53 bits a double holds, used for stored configuration and history values
+      static fixed from_double(double d) {
+         bool neg = d < 0;
+         double a = neg ? -d : d;
+         uint64_t ip = static_cast<uint64_t>(a);
+         uint64_t fp = static_cast<uint64_t>((a - static_cast<double>(ip)) * 18446744073709551616.0);
+         raw_type r = static_cast<raw_type>((static_cast<uraw_type>(ip) << 64) | fp);
+         return from_raw(neg ? -r : r);
+      }
+
+      double to_double() const {
+         bool neg = raw < 0;
+         uraw_type a = neg ? -static_cast<uraw_type>(raw) : static_cast<uraw_type>(raw);
+         double d = static_cast<double>(static_cast<uint64_t>(a >> 64)) +
+                    static_cast<double>(static_cast<uint64_t>(a)) / 18446744073709551616.0;
+         return neg ? -d : d;
+      }
+
+      // integer part, truncated toward zero
+      constexpr int64_t to_int() const {
+         return static_cast<int64_t>(raw / static_cast<raw_type>(one_raw));
+      }
+
+      constexpr fixed operator-() const { return from_raw(-raw); }
+      constexpr fixed operator+(fixed o) const { return from_raw(raw + o.raw); }
+      constexpr fixed operator-(fixed o) const { return from_raw(raw - o.raw); }
+
+      constexpr fixed operator*(fixed o) const {
+         bool neg = (raw < 0) != (o.raw < 0);
+         uraw_type r = mul_q64(abs(raw), abs(o.raw));
+         return from_raw(neg ? -static_cast<raw_type>(r) : static_cast<raw_type>(r));
+      }
+
+      // divisor must not be zero
+      constexpr fixed operator/(fixed o) const {
+         bool neg = (raw < 0) != (o.raw < 0);
+         uraw_type r = div_q64(abs(raw), abs(o.raw));
+         return from_raw(neg ? -static_cast<raw_type>(r) : static_cast<raw_type>(r));
+      }
+
+      constexpr fixed operator*(int64_t v) const { return from_raw(raw * v); }
+      constexpr fixed operator/(int64_t v) const { return from_raw(raw / v); }
+
+      constexpr bool operator==(fixed o) const { return raw == o.raw; }
+      constexpr bool operator!=(fixed o) const { return raw != o.raw; }
+      constexpr bool operator<(fixed o) const { return raw < o.raw; }
+      constexpr bool operator>(fixed o) const { return raw > o.raw; }
+      constexpr bool operator<=(fixed o) const { return raw <= o.raw; }
+      constexpr bool operator>=(fixed o) const { return raw >= o.raw; }
+
+      static constexpr uraw_type abs(raw_type v) {
+         return v < 0 ? -static_cast<uraw_type>(v) : static_cast<uraw_type>(v);
+      }
+
+      // (a * b) >> 64 from 64 bit partial products, the result must fit in 128 bits
+      static constexpr uraw_type mul_q64(uraw_type a, uraw_type b) {
+         uraw_type ah = a >> 64, al = static_cast<uint64_t>(a);
+         uraw_type bh = b >> 64, bl = static_cast<uint64_t>(b);
+         return ((ah * bh) << 64) + ah * bl + al * bh + ((al * bl) >> 64);
+      }
+
+      // (a << 64) / b, one native division while the dividend fits in 128 bits,
+      // otherwise the integer quotient followed by 64 steps of long division for the fraction
+      static constexpr uraw_type div_q64(uraw_type a, uraw_type b) {
+         if ((a >> 64) == 0) return (a << 64) / b;
+         uraw_type q = a / b;
+         uraw_type r = a % b;
+         for (int i = 0; i < 64; i++) {
+            r <<= 1;
+            q <<= 1;
+            if (r >= b) {
+               r -= b;
+               q |= 1;
+            }
+         }
+         return q;
+      }
+   };
+
+   namespace fixed_detail {
+
+      constexpr fixed::uraw_type u128(uint64_t hi, uint64_t lo) {
+         return (static_cast<fixed::uraw_type>(hi) << 64) | lo;
+      }
+
+      // 2^(2^-i) for i = 1..64, rounded to nearest
+      constexpr std::array<fixed::uraw_type, 64> exp2_table = {
+         u128(0x1, 0x6a09e667f3bcc909ull), // 2^(2^-1)
+         u128(0x1, 0x306fe0a31b7152dfull), // 2^(2^-2)
+         u128(0x1, 0x172b83c7d517adceull), // 2^(2^-3)
+         u128(0x1, 0x0b5586cf9890f62aull), // 2^(2^-4)
+         u128(0x1, 0x059b0d31585743aeull), // 2^(2^-5)
+         u128(0x1, 0x02c9a3e778060ee7ull), // 2^(2^-6)
+         u128(0x1, 0x0163da9fb33356d8ull), // 2^(2^-7)
+         u128(0x1, 0x00b1afa5abcbed61ull), // 2^(2^-8)
+         u128(0x1, 0x0058c86da1c09ea2ull), // 2^(2^-9)
+         u128(0x1, 0x002c605e2e8cec50ull), // 2^(2^-10)
+         u128(0x1, 0x00162f3904051fa1ull), // 2^(2^-11)
+         u128(0x1, 0x000b175effdc76baull), // 2^(2^-12)
+         u128(0x1, 0x00058ba01fb9f96dull), // 2^(2^-13)
+         u128(0x1, 0x0002c5cc37da9492ull), // 2^(2^-14)
+         u128(0x1, 0x000162e525ee0547ull), // 2^(2^-15)
+         u128(0x1, 0x0000b17255775c04ull), // 2^(2^-16)
+         u128(0x1, 0x000058b91b5bc9aeull), // 2^(2^-17)
+         u128(0x1, 0x00002c5c89d5ec6dull), // 2^(2^-18)
+         u128(0x1, 0x0000162e43f4f831ull), // 2^(2^-19)
+         u128(0x1, 0x00000b1721bcfc9aull), // 2^(2^-20)
+         u128(0x1, 0x0000058b90cf1e6eull), // 2^(2^-21)
+         u128(0x1, 0x000002c5c863b73full), // 2^(2^-22)
+         u128(0x1, 0x00000162e430e5a2ull), // 2^(2^-23)
+         u128(0x1, 0x000000b172183551ull), // 2^(2^-24)
+         u128(0x1, 0x00000058b90c0b49ull), // 2^(2^-25)
+         u128(0x1, 0x0000002c5c8601ccull), // 2^(2^-26)
+         u128(0x1, 0x000000162e42fff0ull), // 2^(2^-27)
+         u128(0x1, 0x0000000b17217fbbull), // 2^(2^-28)
+         u128(0x1, 0x000000058b90bfceull), // 2^(2^-29)
+         u128(0x1, 0x00000002c5c85fe3ull), // 2^(2^-30)
+         u128(0x1, 0x0000000162e42ff1ull), // 2^(2^-31)
+         u128(0x1, 0x00000000b17217f8ull), // 2^(2^-32)
+         u128(0x1, 0x0000000058b90bfcull), // 2^(2^-33)
+         u128(0x1, 0x000000002c5c85feull), // 2^(2^-34)
+         u128(0x1, 0x00000000162e42ffull), // 2^(2^-35)
+         u128(0x1, 0x000000000b17217full), // 2^(2^-36)
+         u128(0x1, 0x00000000058b90c0ull), // 2^(2^-37)
+         u128(0x1, 0x0000000002c5c860ull), // 2^(2^-38)
+         u128(0x1, 0x000000000162e430ull), // 2^(2^-39)
+         u128(0x1, 0x0000000000b17218ull), // 2^(2^-40)
+         u128(0x1, 0x000000000058b90cull), // 2^(2^-41)
+         u128(0x1, 0x00000000002c5c86ull), // 2^(2^-42)
+         u128(0x1, 0x0000000000162e43ull), // 2^(2^-43)
+         u128(0x1, 0x00000000000b1721ull), // 2^(2^-44)
+         u128(0x1, 0x0000000000058b91ull), // 2^(2^-45)
+         u128(0x1, 0x000000000002c5c8ull), // 2^(2^-46)
+         u128(0x1, 0x00000000000162e4ull), // 2^(2^-47)
+         u128(0x1, 0x000000000000b172ull), // 2^(2^-48)
+         u128(0x1, 0x00000000000058b9ull), // 2^(2^-49)
+         u128(0x1, 0x0000000000002c5dull), // 2^(2^-50)
+         u128(0x1, 0x000000000000162eull), // 2^(2^-51)
+         u128(0x1, 0x0000000000000b17ull), // 2^(2^-52)
+         u128(0x1, 0x000000000000058cull), // 2^(2^-53)
+         u128(0x1, 0x00000000000002c6ull), // 2^(2^-54)
+         u128(0x1, 0x0000000000000163ull), // 2^(2^-55)
+         u128(0x1, 0x00000000000000b1ull), // 2^(2^-56)
+         u128(0x1, 0x0000000000000059ull), // 2^(2^-57)
+         u128(0x1, 0x000000000000002cull), // 2^(2^-58)
+         u128(0x1, 0x0000000000000016ull), // 2^(2^-59)
+         u128(0x1, 0x000000000000000bull), // 2^(2^-60)
+         u128(0x1, 0x0000000000000006ull), // 2^(2^-61)
+         u128(0x1, 0x0000000000000003ull), // 2^(2^-62)
+         u128(0x1, 0x0000000000000001ull), // 2^(2^-63)
+         u128(0x1, 0x0000000000000001ull), // 2^(2^-64)
+      };
+
+      // 2^(-2^-i) for i = 1..64, rounded to nearest
+      constexpr std::array<fixed::uraw_type, 64> exp2_inv_table = {
+         u128(0, 0xb504f333f9de6484ull), // 2^(-2^-1)
+         u128(0, 0xd744fccad69d6af4ull), // 2^(-2^-2)
+         u128(0, 0xeac0c6e7dd24392full), // 2^(-2^-3)
+         u128(0, 0xf5257d152486cc2cull), // 2^(-2^-4)
+         u128(0, 0xfa83b2db722a033aull), // 2^(-2^-5)
+         u128(0, 0xfd3e0c0cf486c175ull), // 2^(-2^-6)
+         u128(0, 0xfe9e115c7b8f884cull), // 2^(-2^-7)
+         u128(0, 0xff4ecb59511ec8a5ull), // 2^(-2^-8)
+         u128(0, 0xffa756521c8daed2ull), // 2^(-2^-9)
+         u128(0, 0xffd3a751c0f7e10cull), // 2^(-2^-10)
+         u128(0, 0xffe9d2b2f7db2756ull), // 2^(-2^-11)
+         u128(0, 0xfff4e91bff1b8c3eull), // 2^(-2^-12)
+         u128(0, 0xfffa747ea0040664ull), // 2^(-2^-13)
+         u128(0, 0xfffd3a3b7814eb54ull), // 2^(-2^-14)
+         u128(0, 0xfffe9d1cc60ddab1ull), // 2^(-2^-15)
+         u128(0, 0xffff4e8e25879bfaull), // 2^(-2^-16)
+         u128(0, 0xffffa7470363f451ull), // 2^(-2^-17)
+         u128(0, 0xffffd3a37dda0313ull), // 2^(-2^-18)
+         u128(0, 0xffffe9d1bdf703afull), // 2^(-2^-19)
+         u128(0, 0xfffff4e8debe025eull), // 2^(-2^-20)
+         u128(0, 0xfffffa746f4fa150ull), // 2^(-2^-21)
+         u128(0, 0xfffffd3a37a3f8b0ull), // 2^(-2^-22)
+         u128(0, 0xfffffe9d1bd1065aull), // 2^(-2^-23)
+         u128(0, 0xffffff4e8de845aeull), // 2^(-2^-24)
+         u128(0, 0xffffffa746f41377ull), // 2^(-2^-25)
+         u128(0, 0xffffffd3a37a05e4ull), // 2^(-2^-26)
+         u128(0, 0xffffffe9d1bd01fcull), // 2^(-2^-27)
+         u128(0, 0xfffffff4e8de80c0ull), // 2^(-2^-28)
+         u128(0, 0xfffffffa746f4051ull), // 2^(-2^-29)
+         u128(0, 0xfffffffd3a37a025ull), // 2^(-2^-30)
+         u128(0, 0xfffffffe9d1bd011ull), // 2^(-2^-31)
+         u128(0, 0xffffffff4e8de808ull), // 2^(-2^-32)
+         u128(0, 0xffffffffa746f404ull), // 2^(-2^-33)
+         u128(0, 0xffffffffd3a37a02ull), // 2^(-2^-34)
+         u128(0, 0xffffffffe9d1bd01ull), // 2^(-2^-35)
+         u128(0, 0xfffffffff4e8de81ull), // 2^(-2^-36)
+         u128(0, 0xfffffffffa746f40ull), // 2^(-2^-37)
+         u128(0, 0xfffffffffd3a37a0ull), // 2^(-2^-38)
+         u128(0, 0xfffffffffe9d1bd0ull), // 2^(-2^-39)
+         u128(0, 0xffffffffff4e8de8ull), // 2^(-2^-40)
+         u128(0, 0xffffffffffa746f4ull), // 2^(-2^-41)
+         u128(0, 0xffffffffffd3a37aull), // 2^(-2^-42)
+         u128(0, 0xffffffffffe9d1bdull), // 2^(-2^-43)
+         u128(0, 0xfffffffffff4e8dfull), // 2^(-2^-44)
+         u128(0, 0xfffffffffffa746full), // 2^(-2^-45)
+         u128(0, 0xfffffffffffd3a38ull), // 2^(-2^-46)
+         u128(0, 0xfffffffffffe9d1cull), // 2^(-2^-47)
+         u128(0, 0xffffffffffff4e8eull), // 2^(-2^-48)
+         u128(0, 0xffffffffffffa747ull), // 2^(-2^-49)
+         u128(0, 0xffffffffffffd3a3ull), // 2^(-2^-50)
+         u128(0, 0xffffffffffffe9d2ull), // 2^(-2^-51)
+         u128(0, 0xfffffffffffff4e9ull), // 2^(-2^-52)
+         u128(0, 0xfffffffffffffa74ull), // 2^(-2^-53)
+         u128(0, 0xfffffffffffffd3aull), // 2^(-2^-54)
+         u128(0, 0xfffffffffffffe9dull), // 2^(-2^-55)
+         u128(0, 0xffffffffffffff4full), // 2^(-2^-56)
+         u128(0, 0xffffffffffffffa7ull), // 2^(-2^-57)
+         u128(0, 0xffffffffffffffd4ull), // 2^(-2^-58)
+         u128(0, 0xffffffffffffffeaull), // 2^(-2^-59)
+         u128(0, 0xfffffffffffffff5ull), // 2^(-2^-60)
+         u128(0, 0xfffffffffffffffaull), // 2^(-2^-61)
+         u128(0, 0xfffffffffffffffdull), // 2^(-2^-62)
+         u128(0, 0xffffffffffffffffull), // 2^(-2^-63)
+         u128(0, 0xffffffffffffffffull), // 2^(-2^-64)
+      };
+
+   }
+
+   constexpr fixed fixed_one = fixed::from_raw(static_cast<fixed::raw_type>(fixed::one_raw));
+   constexpr fixed fixed_ln2 = fixed::from_raw(static_cast<fixed::raw_type>(fixed_detail::u128(0x0, 0xb17217f7d1cf79acull)));
+   constexpr fixed fixed_log2e = fixed::from_raw(static_cast<fixed::raw_type>(fixed_detail::u128(0x1, 0x71547652b82fe177ull)));
+   constexpr fixed fixed_e = fixed::from_raw(static_cast<fixed::raw_type>(fixed_detail::u128(0x2, 0xb7e151628aed2a6bull)));
+
+   // base 2 logarithm, x must be greater than zero
+   // the integer part comes from the leading bit, each fraction bit from one table compare and multiply
+   constexpr fixed log2(fixed x) {
+      fixed::uraw_type y = static_cast<fixed::uraw_type>(x.raw);
+      int64_t msb = 127;
+      while (((y >> msb) & 1) == 0) msb--;
+      int64_t ip = msb - 64;
+      y = ip >= 0 ? y >> ip : y << -ip;
+
+      fixed::uraw_type fp = 0;
+      for (int i = 0; i < 64; i++) {
+         if (y >= fixed_detail::exp2_table[i]) {
+            y = fixed::mul_q64(y, fixed_detail::exp2_inv_table[i]);
+            fp |= static_cast<fixed::uraw_type>(1) << (63 - i);
+         }
+      }
+      return fixed::from_int(ip) + fixed::from_raw(static_cast<fixed::raw_type>(fp));
+   }
+
+   // 2^x, multiplying in one table entry per set fraction bit then shifting by the integer part
+   constexpr fixed exp2(fixed x) {
+      fixed::raw_type ip = x.raw >> 64; // floor, so the fraction below is never negative
+      uint64_t fp = static_cast<uint64_t>(x.raw);
+      fixed::uraw_type y = fixed::one_raw;
+      for (int i = 0; i < 64; i++) {
+         if ((fp >> (63 - i)) & 1) y = fixed::mul_q64(y, fixed_detail::exp2_table[i]);
+      }
+      y = ip >= 0 ? y << ip : y >> -ip;
+      return fixed::from_raw(static_cast<fixed::raw_type>(y));
+   }
+
+   constexpr fixed ln(fixed x) { return log2(x) * fixed_ln2; }
+
+   constexpr fixed exp(fixed x) { return exp2(x * fixed_log2e); }
+
+   // base^exponent for a positive base
+   constexpr fixed pow(fixed base, fixed exponent) { return exp2(exponent * log2(base)); }
+
+   constexpr fixed min(fixed a, fixed b) { return a < b ? a : b; }
+
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <eosio.system/fixed_point.hpp>
+
+// UX inflation model for one period, free of chain dependencies so the contract, tests and tools share it
+namespace ux {
+
+   // smallest and largest utilisation the model accepts, keeps the logarithm in get_c finite
+   constexpr fixed usage_floor = fixed::from_ratio(1, 100000000000);
+   constexpr fixed usage_ceiling = fixed_one - usage_floor;
+
+   // share of system capacity used, raised to usage_floor
+   constexpr fixed usage_fraction(uint64_t used, uint64_t capacity) {
+      fixed usage = fixed::from_ratio(used, capacity);
+      return usage < usage_floor ? usage_floor : usage;
+   }
+
+   // calculate a moving average
+   constexpr fixed calcMA(fixed sum, uint64_t timeperiod, fixed newVal) {
+      return (sum + newVal) / static_cast<int64_t>(timeperiod);
+   }
+
+   // calculate an exponential moving average
+   constexpr fixed calcEMA(fixed previousAverage, uint64_t timePeriod, fixed newVal) {
+      return (newVal - previousAverage) * 2 / static_cast<int64_t>(timePeriod + 1) + previousAverage;
+   }
+
+   // model C[x] = -x * ln(x) * exp(1)
+   constexpr fixed get_c(fixed x) {
+      return -(x * ln(x)) * fixed_e;
+   }
+
+   struct inflation_inputs {
+      uint64_t day_count = 0; // daycount of the latest history row
+      uint64_t history_count = 0; // history rows before this period, the ema takes over once it reaches draglimit
+      uint64_t draglimit = 2;
+      fixed usage_cpu; // from usage_fraction
+      fixed usage_net;
+      fixed ma_cpu_total; // sum of the previous draglimit - 1 usage samples
+      fixed ma_net_total;
+      fixed previous_ma_cpu; // ma_cpu and ma_net of the latest history row, the model's ema is seeded from these
+      fixed previous_ma_net;
+      fixed initial_value_transfer_rate;
+      fixed max_pay_constant;
+   };
+
+   struct inflation_outputs {
+      fixed ma_cpu;
+      fixed ma_net;
+      fixed ema_cpu; // before halving
+      fixed ema_net;
+      fixed ema_util_total;
+      fixed utility;
+      fixed utility_daily;
+      fixed bppay;
+      fixed bppay_daily;
+      fixed inflation;
+      fixed inflation_daily;
+      fixed cpu_pay; // share of supply issued to usage payments
+      fixed final_bp_daily; // share of supply issued to producer pay
+   };
+
+   constexpr inflation_outputs compute_inflation(const inflation_inputs& in) {
+      inflation_outputs out;
+
+      fixed VT = exp2(-fixed::from_ratio(in.day_count, 365)) * in.initial_value_transfer_rate;
+
+      // calculate period for moving averages during bootstrap period
+      uint64_t period = in.day_count < in.draglimit ? in.day_count + 1 : in.draglimit;
+
+      out.ma_cpu = calcMA(in.ma_cpu_total, period, in.usage_cpu);
+      out.ma_net = calcMA(in.ma_net_total, period, in.usage_net);
+
+      // use simple moving average until we reach draglimit samples
+      if (in.history_count >= in.draglimit) {
+         out.ema_cpu = calcEMA(in.previous_ma_cpu, in.draglimit, in.usage_cpu);
+         out.ema_net = calcEMA(in.previous_ma_net, in.draglimit, in.usage_net);
+      } else {
+         out.ema_cpu = out.ma_cpu;
+         out.ema_net = out.ma_net;
+      }
+
+      fixed UTIL_CPU_EMA = out.ema_cpu / 2;
+      fixed UTIL_NET_EMA = out.ema_net / 2;
+      fixed UTIL_TOTAL_EMA = UTIL_CPU_EMA + UTIL_NET_EMA;
+
+      if (UTIL_TOTAL_EMA < usage_floor) {
+         UTIL_CPU_EMA = UTIL_CPU_EMA / UTIL_TOTAL_EMA * usage_floor;
+         UTIL_NET_EMA = UTIL_NET_EMA / UTIL_TOTAL_EMA * usage_floor;
+         UTIL_TOTAL_EMA = usage_floor;
+      }
+
+      if (UTIL_TOTAL_EMA > usage_ceiling) {
+         UTIL_CPU_EMA = UTIL_CPU_EMA / UTIL_TOTAL_EMA * usage_ceiling;
+         UTIL_NET_EMA = UTIL_NET_EMA / UTIL_TOTAL_EMA * usage_ceiling;
+         UTIL_TOTAL_EMA = usage_ceiling;
+      }
+      out.ema_util_total = UTIL_TOTAL_EMA;
+
+      fixed c = get_c(UTIL_TOTAL_EMA);
+      out.inflation = (fixed_one - UTIL_TOTAL_EMA) / (fixed_one - UTIL_TOTAL_EMA - c * VT) - fixed_one;
+
+      fixed BP_U = in.max_pay_constant * c;
+      out.utility = pow(fixed_one + out.inflation, fixed_one - BP_U) - fixed_one;
+      out.bppay = out.inflation - out.utility;
+
+      // nothing left to split if the model produced no inflation
+      if (out.inflation <= fixed()) return out;
+
+      // Inflation waterfall
+      fixed Waterfall_bp = out.inflation * (fixed_one - UTIL_TOTAL_EMA);
+      fixed Bppay_final = min(out.bppay, Waterfall_bp);
+      fixed Uppaynet = out.inflation - Bppay_final;
+
+      out.inflation_daily = pow(fixed_one + out.inflation, fixed::from_ratio(1, 365)) - fixed_one;
+
+      //allocate proportionally to Utility
+      out.utility_daily = Uppaynet / out.inflation * out.inflation_daily;
+      out.cpu_pay = out.utility_daily * (UTIL_CPU_EMA / UTIL_TOTAL_EMA);
+      fixed NET_pay = out.utility_daily - out.cpu_pay;
+
+      //allocate proportionally to BPs
+      out.bppay_daily = Bppay_final / out.inflation * out.inflation_daily;
+      out.final_bp_daily = out.bppay_daily + NET_pay;
+
+      return out;
+   }
+
+}
@@ -3,46 +3,74 @@
 
 #pragma once
 
-#include <math.h>
+#include <eosio/binary_extension.hpp>
 #include <eosio/crypto.hpp>
+#include <eosio.system/inflation_model.hpp>
 
 namespace eosiosystem {
 
    using namespace eosio;
 
-   // used primarily for individual accounts cpu usage, but also totals metrics
-   struct metric {
-     name a;
-     uint64_t u;
-   };
-
-   struct [[eosio::table("resusagedata"), eosio::contract("eosio.system")]] datasets
+   // inflation model settings, the usage it is applied to is reported by the eosio.oracle contract through issueinfl
+   struct [[eosio::table("resinflconf"), eosio::contract("eosio.system")]] inflation_config_state
    {
-      uint64_t id;
-      checksum256 hash;
-      std::vector<metric> data; // hash of each individual data submission
-      uint64_t primary_key() const { return (id); }
-      checksum256 by_hash() const { return hash; }
+      uint32_t emadraglimit = 2;
+      double initial_value_transfer_rate = 0.1;
+      double max_pay_constant = 0.2947;
+      time_point_sec last_period_inflation_print;
+      // fields from here on were appended to a deployed table, rows written before them read as the initial values
+      binary_extension<uint16_t> rollover_rows = 100; // eosio.oracle rows onblock lets the rollover clear per step once a period has ended, 0 leaves it to nextperiod
+      binary_extension<time_point_sec> next_rollover_step = time_point_sec(); // onblock schedules no step for an ended period before this time
    };
 
-   struct [[eosio::table("resourceconf"), eosio::contract("eosio.system")]] resource_config_state
+   // eosio.oracle settings and rollover progress, read by onblock to tell when the period has to roll over
+   struct [[eosio::table("resourceconf"), eosio::contract("eosio.oracle")]] resource_config_state
    {
       uint32_t period_seconds = 86400; // how many seconds in each period, low numbers used for testing
       uint16_t oracle_consensus_threshold; // how many oracles are required for mode to trigger distribution
       uint16_t dataset_batch_size; // how many individual accounts are submitted at once
       time_point_sec period_start; // when the period currently open for reporting started
-      std::vector<name> submitting_oracles; // oracles which have sent at least one dataset for this period
       bool inflation_transferred = false;
-      std::vector<uint16_t> account_distributions_made = {}; // which datasets have reached consensus and been distributed
+      bool active = false;
+      uint8_t hash_version = 1; // dataset hash format, 0 = concatenated text, 1 = packed binary metrics
+      uint8_t rollover_stage = 0; // 0 = period open, 1 = oracles scored and the rollover is clearing the period tables, 2 = the rollover is queueing datasets agreed on before the inflation for distribute
+      uint8_t distribution_mode = 0; // 0 = resaccpay balance per account, 1 = claim root per dataset redeemed with claimproof
+      uint64_t catchup_cursor = 0; // next resconsensus id the rollover checks while rollover_stage is 2
+      uint8_t dedupe_mode = 1; // 1 = each oracle's accounts must be strictly ascending across its datasets, so none is submitted twice, 0 = unordered
+      uint32_t claim_expiry_seconds = 0; // resaccpay balances not paid into for this long, and claim roots this long after their period started, can be swept by sweepclaims, 0 = never
+      name sweep_account = "eosio.saving"_n; // receives swept balances
+   };
+
+   // oracle settings eosio.system kept before eosio.oracle took the oracle over, read when eosio.oracle is set up
+   // and erased by migrateres once every other legacy oracle row is gone
+   struct [[eosio::table("resourceconf"), eosio::contract("eosio.system")]] legacy_resource_config_state
+   {
+      uint32_t period_seconds = 86400;
+      uint16_t oracle_consensus_threshold;
+      uint16_t dataset_batch_size;
+      time_point_sec period_start;
+      std::vector<name> submitting_oracles;
+      bool inflation_transferred = false;
+      std::vector<uint16_t> account_distributions_made; // datasets distributed before resdistrib was added
       uint32_t emadraglimit = 2;
       double initial_value_transfer_rate = 0.1;
       double max_pay_constant = 0.2947;
       time_point_sec last_period_inflation_print;
       bool active = false;
+      // fields from here on were appended to a deployed table, rows written before them read as the initial values
+      binary_extension<uint8_t> hash_version = 0;
+      binary_extension<uint8_t> rollover_stage = 0;
+      binary_extension<uint8_t> distribution_mode = 0;
+      binary_extension<uint64_t> catchup_cursor = 0;
+      binary_extension<uint8_t> dedupe_mode = 1;
+      binary_extension<uint32_t> claim_expiry_seconds = 0;
+      binary_extension<name> sweep_account = "eosio.saving"_n;
+      binary_extension<bool> pay_index_migrated = false;
+      binary_extension<uint64_t> pay_migration_cursor = 0;
    };
 
-   // holds the points score of oracles (based on commit-reveal and modal hash matches)
-   struct [[eosio::table("ressources"), eosio::contract("eosio.system")]] sources
+   // oracle scores and unclaimed balances eosio.system held before eosio.oracle, moved into it by migrateres
+   struct [[eosio::table("ressources"), eosio::contract("eosio.system")]] legacy_sources
    {
       name account;
       uint32_t submissions_score;
@@ -50,18 +78,65 @@ namespace eosiosystem {
       uint64_t primary_key() const { return (account.value); }
    };
 
-   // totals data as submitted by each oracle for current period
-   struct [[eosio::table("ressysusage"), eosio::contract("eosio.system")]] system_usage
+   struct [[eosio::table("resaccpay"), eosio::contract("eosio.system")]] legacy_account_pay
    {
-      name source; // oracle source
-      uint64_t total_cpu_us;
-      uint64_t total_net_words;
-      uint64_t allocated_cpu = 0; // how much has been allocated to individual accounts
-      std::vector<checksum256> submission_hash_list; // hash of each individual data submission
-      checksum256 all_data_hash; // acts as commitment for all subsequent data for scoring
+      name account;
+      asset balance;
+      time_point_sec timestamp;
+      uint64_t primary_key() const { return (account.value); }
+   };
+
+   // period tables eosio.system held before eosio.oracle, erased by migrateres
+   // only the leading fields every earlier layout of a row starts with are read, the index entries go with the row
+
+   struct [[eosio::table("ressysusage"), eosio::contract("eosio.system")]] legacy_system_usage
+   {
+      name source;
       uint64_t primary_key() const { return (source.value); }
    };
 
+   struct [[eosio::table("resusagedata"), eosio::contract("eosio.system")]] legacy_datasets
+   {
+      uint64_t id;
+      checksum256 hash;
+      uint64_t primary_key() const { return (id); }
+      checksum256 by_hash() const { return hash; }
+   };
+
+   struct [[eosio::table("resconsensus"), eosio::contract("eosio.system")]] legacy_consensus
+   {
+      uint64_t id;
+      uint16_t dataset_id;
+      checksum256 hash;
+      uint64_t primary_key() const { return (id); }
+      uint128_t by_dataset_hash() const { return (static_cast<uint128_t>(dataset_id) << 64) | static_cast<uint64_t>(hash.get_array()[0]); }
+   };
+
+   // also read by eosio.oracle's initresource, which settles the datasets already paid out in the period it takes over
+   struct [[eosio::table("resdistrib"), eosio::contract("eosio.system")]] legacy_dataset_distribution
+   {
+      uint16_t dataset_id;
+      binary_extension<name> first_account = name(); // absent in rows written before dedupe_mode
+      binary_extension<name> last_account = name();
+      uint64_t primary_key() const { return (dataset_id); }
+      uint64_t by_first_account() const { return (*first_account).value; }
+   };
+
+   struct [[eosio::table("resclaims"), eosio::contract("eosio.system")]] legacy_claim_root
+   {
+      uint64_t id;
+      time_point_sec period_start;
+      uint16_t dataset_id;
+      uint64_t primary_key() const { return (id); }
+      uint128_t by_period_dataset() const { return (static_cast<uint128_t>(period_start.sec_since_epoch()) << 64) | dataset_id; }
+   };
+
+   // producers of the last proposed schedule, sorted by name, written by update_elected_producers
+   struct [[eosio::table("resoracles"), eosio::contract("eosio.system")]] oracle_set
+   {
+      std::vector<name> oracles;
+   };
+
    struct [[eosio::table("reshistory"), eosio::contract("eosio.system")]] system_usage_history
    {
       uint64_t id;
@@ -89,12 +164,18 @@ namespace eosiosystem {
       uint64_t primary_key() const { return (id); }
    };
 
-   struct [[eosio::table("resaccpay"), eosio::contract("eosio.system")]] account_pay
+   // circular buffer of the most recent history samples summed by the moving averages, as raw ux::fixed values
+   struct [[eosio::table("resmastate"), eosio::contract("eosio.system")]] moving_average_state
    {
-      name account; // account consuming the resource
-      asset balance; // asset balance
-      time_point_sec timestamp;
-      uint64_t primary_key() const { return (account.value); }
+      uint32_t window = 0; // samples held, emadraglimit - 1
+      uint64_t last_history_id = 0; // reshistory id of the newest sample held
+      uint32_t head = 0; // position of the oldest sample once the buffer is full
+      std::vector<int128_t> cpu_samples;
+      std::vector<int128_t> net_samples;
+      int128_t cpu_sum = 0;
+      int128_t net_sum = 0;
+      int128_t ma_cpu = 0; // moving averages of the newest history row, which seed the next ema
+      int128_t ma_net = 0;
    };
 
    // for getting max_supply of UTX token contract
@@ -105,51 +186,23 @@ namespace eosiosystem {
       uint64_t primary_key()const { return supply.symbol.code().raw(); }
    };
 
+   typedef eosio::singleton< "resinflconf"_n, inflation_config_state > inflation_config_singleton;
    typedef eosio::singleton< "resourceconf"_n, resource_config_state > resource_config_singleton;
-   typedef eosio::multi_index<"ressources"_n, sources> sources_table;
-   typedef eosio::multi_index<"ressysusage"_n, system_usage> system_usage_table;
+   typedef eosio::singleton< "resourceconf"_n, legacy_resource_config_state > legacy_resource_config_singleton;
+   typedef eosio::multi_index<"ressources"_n, legacy_sources> legacy_sources_table;
+   typedef eosio::multi_index<"resaccpay"_n, legacy_account_pay> legacy_account_pay_table;
+   typedef eosio::multi_index<"ressysusage"_n, legacy_system_usage> legacy_system_usage_table;
+   typedef eosio::multi_index<"resusagedata"_n, legacy_datasets,
+            indexed_by<"hash"_n, const_mem_fun<legacy_datasets, checksum256, &legacy_datasets::by_hash>>> legacy_datasets_table;
+   typedef eosio::multi_index<"resconsensus"_n, legacy_consensus,
+            indexed_by<"datasethash"_n, const_mem_fun<legacy_consensus, uint128_t, &legacy_consensus::by_dataset_hash>>> legacy_consensus_table;
+   typedef eosio::multi_index<"resdistrib"_n, legacy_dataset_distribution,
+            indexed_by<"firstacct"_n, const_mem_fun<legacy_dataset_distribution, uint64_t, &legacy_dataset_distribution::by_first_account>>> legacy_dataset_distribution_table;
+   typedef eosio::multi_index<"resclaims"_n, legacy_claim_root,
+            indexed_by<"perioddata"_n, const_mem_fun<legacy_claim_root, uint128_t, &legacy_claim_root::by_period_dataset>>> legacy_claim_root_table;
+   typedef eosio::singleton< "resoracles"_n, oracle_set > oracle_set_singleton;
    typedef eosio::multi_index<"reshistory"_n, system_usage_history> system_usage_history_table;
-   typedef eosio::multi_index<"resaccpay"_n, account_pay> account_pay_table;
-   typedef eosio::multi_index<"resusagedata"_n, datasets, 
-            indexed_by<"hash"_n, const_mem_fun<datasets, checksum256, &datasets::by_hash>>> datasets_table;
+   typedef eosio::singleton< "resmastate"_n, moving_average_state > moving_average_singleton;
    typedef eosio::multi_index< "stat"_n, currency_stats > stats;
 
 }
-
-namespace ux {
-
-  // calculate a moving average
-  static double calcMA(double sum, uint8_t timeperiod, double newVal)
-  {
-    auto rslt = sum + newVal;
-    return rslt / (timeperiod);
-  }
-
-  // calculate an exponential moving average
-  static double calcEMA(double previousAverage, int timePeriod, double newVal)
-  {
-    auto mult = 2.0 / (timePeriod + 1.0);
-    auto rslt = (newVal - previousAverage) * mult + previousAverage;
-    return rslt;
-  }
-
-  static double get_c(double x)
-  { // model C[x] = -x * ln(x) * exp(1)
-    double p1 = -x;
-    double p2 = log(double(x));
-    double p3 = exp(1);
-    return p1 * p2 * p3;
-  }
-
-  static double round(double var)
-  {
-    //array of chars to store number as a string.
-    char str[40];
-    // Print in string the value of var with 4 decimal points
-    sprintf(str, "%.4f", var);
-    // scan string value in var
-    sscanf(str, "%f", &var);
-    return var;
-  }
-
-}
\ No newline at end of file
@@ -68,6 +68,9 @@ namespace eosiosystem {
             }
          }
       }
+
+      /// roll the resource oracle's period over a few rows at a time once it has ended
+      step_oracle_rollover();
    }
 
    ACTION system_contract::claimrewards( const name& owner ) {
@@ -1,205 +1,119 @@
 #include <eosio.system/eosio.system.hpp>
 #include <eosio.token/eosio.token.hpp>
+#include <eosio/transaction.hpp>
+
+#include <algorithm>
 
 
 namespace eosiosystem {
 
-    // function for converting checksum256 into string
-    template<typename CharT>
-    static std::string to_hex(const CharT* d, uint32_t s) {
-      std::string r;
-      const char* to_hex="0123456789abcdef";
-      uint8_t* c = (uint8_t*)d;
-      for( uint32_t i = 0; i < s; ++i ) {
-        (r += to_hex[(c[i] >> 4)]) += to_hex[(c[i] & 0x0f)];
+    // refill the moving average window from the newest history rows, only needed when the window changes
+    static void rebuild_moving_average(moving_average_state& ma, const system_usage_history_table& u_t, uint32_t window) {
+      ma = moving_average_state{};
+      ma.window = window;
+      auto itr = u_t.end();
+      if (itr == u_t.begin()) return;
+      itr--;
+      ma.last_history_id = itr->id;
+      ma.ma_cpu = ux::fixed::from_double(itr->ma_cpu).raw;
+      ma.ma_net = ux::fixed::from_double(itr->ma_net).raw;
+      itr = u_t.end();
+      while (itr != u_t.begin() && ma.cpu_samples.size() < window) {
+        itr--;
+        int128_t use_cpu = ux::fixed::from_double(itr->use_cpu).raw;
+        int128_t use_net = ux::fixed::from_double(itr->use_net).raw;
+        ma.cpu_samples.insert(ma.cpu_samples.begin(), use_cpu);
+        ma.net_samples.insert(ma.net_samples.begin(), use_net);
+        ma.cpu_sum += use_cpu;
+        ma.net_sum += use_net;
+      }
+    }
+
+    // add the newest sample, evicting the oldest once the window is full
+    static void push_moving_average(moving_average_state& ma, uint64_t history_id, ux::fixed use_cpu, ux::fixed use_net, ux::fixed ma_cpu, ux::fixed ma_net) {
+      ma.last_history_id = history_id;
+      ma.ma_cpu = ma_cpu.raw;
+      ma.ma_net = ma_net.raw;
+      if (ma.window == 0) return;
+      if (ma.cpu_samples.size() < ma.window) {
+        ma.cpu_samples.push_back(use_cpu.raw);
+        ma.net_samples.push_back(use_net.raw);
+        ma.cpu_sum += use_cpu.raw;
+        ma.net_sum += use_net.raw;
+        return;
       }
-      return r;
+      ma.cpu_sum += use_cpu.raw - ma.cpu_samples[ma.head];
+      ma.net_sum += use_net.raw - ma.net_samples[ma.head];
+      ma.cpu_samples[ma.head] = use_cpu.raw;
+      ma.net_samples[ma.head] = use_net.raw;
+      ma.head = (ma.head + 1) % ma.window;
     }
 
-    // check if calling account is a qualified oracle
-    bool is_oracle(const name owner){
-      producers_table ptable("eosio"_n, name("eosio").value);
-      auto p_idx = ptable.get_index<"prototalvote"_n>();
-      auto p_itr = p_idx.begin();
-      uint64_t count = 0;
-      while (p_itr != p_idx.end()) {
-        if (p_itr->owner==owner) return true;
-        p_itr++;
-        count++;
-        if (count==21) break;
+    // erase up to max_rows rows from the front of a table, returning how many went
+    template <typename Table>
+    static uint32_t erase_rows(Table& table, uint32_t max_rows) {
+      uint32_t erased = 0;
+      auto itr = table.begin();
+      while (itr != table.end() && erased < max_rows) {
+        itr = table.erase(itr);
+        erased++;
       }
-      return false;
+      return erased;
     }
 
-    // called from settotalusg 
+    // called from issueinfl
     // todo - calculate payment for oracles in future version
     void system_contract::set_total(uint64_t total_cpu_us, uint64_t total_net_words, time_point_sec period_start)
     {
-        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
+        auto _inflation_config_state = _inflation_config.get_or_create(_self, inflation_config_state{});
 
         system_usage_history_table u_t(get_self(), get_self().value);
         auto itr = u_t.end();
         itr--;
 
-        // Initial Inflation
-        double MP = _resource_config_state.max_pay_constant;
-
-        uint64_t draglimit = _resource_config_state.emadraglimit;
+        uint64_t draglimit = _inflation_config_state.emadraglimit;
         uint64_t day_count = itr->daycount;
 
         // restrict inflation to the first 3 years after resource model deployment (2 normal years + 1 leap year)
         check( day_count < 1096, "inflation period has ended");
 
-        double VT = pow(2, -(static_cast<double>(day_count) / 365)) * _resource_config_state.initial_value_transfer_rate;
-
-        double previousAverageCPU = itr->ma_cpu;
-        double previousAverageNET = itr->ma_net;
-
-
         uint64_t system_max_cpu = static_cast<uint64_t>(_gstate.max_block_cpu_usage) * 2 * 60 * 60 * 24;
         check( total_cpu_us <= system_max_cpu, "measured cpu usage is greater than system total");
-        double usage_cpu = static_cast<double>(total_cpu_us) / system_max_cpu;
-        print("usage_cpu:: ", std::to_string(usage_cpu), "\n");
-
-        if(usage_cpu < 0.00000000001) {
-            usage_cpu = 0.00000000001;
-        }
-        print("adjusted usage_cpu:: ", std::to_string(usage_cpu), "\n");
 
         uint64_t system_max_net = static_cast<uint64_t>(_gstate.max_block_net_usage) * 2 * 60 * 60 * 24;
         check( total_net_words * 8 <= system_max_net, "measured net usage is greater than system total");
-        double usage_net = static_cast<double>(total_net_words * 8) / system_max_net;
 
-        if(usage_net < 0.00000000001) {
-            usage_net = 0.00000000001;
+        // sum of the last draglimit - 1 samples, kept in a rolling window rather than read back from history
+        moving_average_singleton ma_singleton(get_self(), get_self().value);
+        auto ma = ma_singleton.get_or_default();
+        if (!ma_singleton.exists() || ma.window != draglimit - 1 || ma.last_history_id != itr->id) {
+            rebuild_moving_average(ma, u_t, draglimit - 1);
         }
-        print("adjusted usage_net:: ", std::to_string(usage_cpu), "\n");
-
-        double net_percent_total = usage_net / (usage_net + usage_cpu);
-        double cpu_percent_total = usage_cpu / (usage_net + usage_cpu);
-
-        print("system_max_net:: ", std::to_string(system_max_net), "\n");
-        print("system_max_cpu:: ", std::to_string(system_max_cpu), "\n");
-
-        double ma_cpu_total = 0.0;
-        double ma_net_total = 0.0;
-
-        itr = u_t.end();
-        for (int i = 1; i < draglimit; i++)
-        {
-            itr--;
-            ma_cpu_total += itr->use_cpu;
-            ma_net_total += itr->use_net;
-
-            if (itr == u_t.begin())
-            {
-                break;
-            }
-        }
-
-        // calculate period for moving averages during bootstrap period
-        uint8_t period = day_count < draglimit ? day_count + 1 : draglimit;
-
-        print("period:: ", std::to_string(period), "\n");
-
-        double UTIL_CPU_MA = ux::calcMA(ma_cpu_total, period, usage_cpu);
-        double UTIL_NET_MA = ux::calcMA(ma_net_total, period, usage_net);
-
-        double raw_util_cpu_ema;
-        double raw_util_net_ema;
 
         uint64_t pk = u_t.available_primary_key();
 
-        // use simple moving average until we reach draglimit samples
-        if (pk >= draglimit)
-        {
-            raw_util_cpu_ema = ux::calcEMA(previousAverageCPU, draglimit, usage_cpu);
-            raw_util_net_ema = ux::calcEMA(previousAverageNET, draglimit, usage_net);
-        }
-        else
-        {
-            raw_util_cpu_ema = UTIL_CPU_MA;
-            raw_util_net_ema = UTIL_NET_MA;
-        }
-        double UTIL_CPU_EMA = raw_util_cpu_ema / 2;
-        double UTIL_NET_EMA = raw_util_net_ema / 2;
-
-        double UTIL_TOTAL_EMA = (UTIL_CPU_EMA + UTIL_NET_EMA);
-
-        if(UTIL_TOTAL_EMA < 0.00000000001) {
-            UTIL_CPU_EMA = UTIL_CPU_EMA / UTIL_TOTAL_EMA * 0.00000000001;
-            UTIL_NET_EMA = UTIL_NET_EMA / UTIL_TOTAL_EMA * 0.00000000001;
-            UTIL_TOTAL_EMA = 0.00000000001;
-        }
-
-        if(UTIL_TOTAL_EMA > 0.99999999999) {
-            UTIL_CPU_EMA = UTIL_CPU_EMA / UTIL_TOTAL_EMA * 0.99999999999;
-            UTIL_NET_EMA = UTIL_NET_EMA / UTIL_TOTAL_EMA * 0.99999999999;
-            UTIL_TOTAL_EMA = 0.99999999999;
-        }
-
-        double inflation = (1 - UTIL_TOTAL_EMA) / (1 - UTIL_TOTAL_EMA - ux::get_c(UTIL_TOTAL_EMA) * VT) - 1;
-
-        double BP_U = MP * ux::get_c(UTIL_TOTAL_EMA);
-        double Upaygross = pow((1 + inflation), (1 - BP_U)) - 1;
-        double Bppay = inflation - Upaygross;
-
-        print("UTIL_CPU_MA:: ", std::to_string(UTIL_CPU_MA), "\n");
-        print("UTIL_NET_MA:: ", std::to_string(UTIL_NET_MA), "\n");
-        print("UTIL_TOTAL_EMA:: ", std::to_string(UTIL_TOTAL_EMA), "\n");
-
-        print("inflation:: ", std::to_string(inflation), "\n");
-
-        print("BP_U:: ", std::to_string(BP_U), "\n");
-
-        print("Upaygross:: ", std::to_string(Upaygross), "\n");
-
-        print("Bppay:: ", std::to_string(Bppay), "\n");
-
-        const asset token_supply = eosio::token::get_supply(token_account, core_symbol().code());
-
-        // Inflation waterfall
-        double Min_Upaynet = inflation * UTIL_TOTAL_EMA;
-
-        print("Min_Upaynet:: ", std::to_string(Min_Upaynet), "\n");
-
-        double Waterfall_bp = inflation * (1 - UTIL_TOTAL_EMA);
-
-        print("Waterfall_bp:: ", std::to_string(Waterfall_bp), "\n");
-
-        double Bppay_final = fmin(Bppay, Waterfall_bp);
-
-        print("Bppay_final:: ", std::to_string(Bppay_final), "\n");
-
-        double Uppaynet = inflation - Bppay_final;
-
-        print("Uppaynet:: ", std::to_string(Uppaynet), "\n");
-
-        double Daily_i_U = pow(1 + inflation, static_cast<double>(1) / 365) - 1;
+        // the model runs in fixed point, doubles are only produced for the history row
+        ux::inflation_inputs in;
+        in.day_count = day_count;
+        in.history_count = pk;
+        in.draglimit = draglimit;
+        in.usage_cpu = ux::usage_fraction(total_cpu_us, system_max_cpu);
+        in.usage_net = ux::usage_fraction(total_net_words * 8, system_max_net);
+        in.ma_cpu_total = ux::fixed::from_raw(ma.cpu_sum);
+        in.ma_net_total = ux::fixed::from_raw(ma.net_sum);
+        in.previous_ma_cpu = ux::fixed::from_raw(ma.ma_cpu);
+        in.previous_ma_net = ux::fixed::from_raw(ma.ma_net);
+        in.initial_value_transfer_rate = ux::fixed::from_double(_inflation_config_state.initial_value_transfer_rate);
+        in.max_pay_constant = ux::fixed::from_double(_inflation_config_state.max_pay_constant);
 
-        print("Daily_i_U:: ", std::to_string(Daily_i_U), "\n");
+        ux::inflation_outputs out = ux::compute_inflation(in);
 
-        double utility_daily = (Uppaynet / inflation) * Daily_i_U;                               //allocate proportionally to Utility
-        print("utility_daily:: ", std::to_string(utility_daily), "\n");
-
-        double CPU_Pay = utility_daily * (UTIL_CPU_EMA / UTIL_TOTAL_EMA);
-        print("CPU_Pay:: ", std::to_string(CPU_Pay), "\n");
-
-        double NET_pay = utility_daily - CPU_Pay;
-        print("NET_pay:: ", std::to_string(NET_pay), "\n");
-
-        double bppay_daily = (Bppay_final / inflation) * Daily_i_U;                            //allocate proportionally to BPs
-        print("bppay_daily:: ", std::to_string(bppay_daily), "\n");
-
-        double Final_BP_daily = bppay_daily + NET_pay;
-        print("Final_BP_daily:: ", std::to_string(Final_BP_daily), "\n");
+        ux::fixed usage_total = in.usage_cpu + in.usage_net;
 
         // calculate inflation amount
-        auto utility_tokens = asset(static_cast<int64_t>( (CPU_Pay * double(token_supply.amount))), core_symbol() );
-        auto bppay_tokens = asset(static_cast<int64_t>( ((Final_BP_daily) * double(token_supply.amount))), core_symbol() );
-
-        print("utility_tokens:: ", utility_tokens.to_string(), "\n");
-        print("bppay_tokens:: ", bppay_tokens.to_string(), "\n");
+        const asset token_supply = eosio::token::get_supply(token_account, core_symbol().code());
+        auto utility_tokens = asset((out.cpu_pay * token_supply.amount).to_int(), core_symbol());
+        auto bppay_tokens = asset((out.final_bp_daily * token_supply.amount).to_int(), core_symbol());
 
         u_t.emplace(get_self(), [&](auto &h) {
             h.id = pk;
@@ -207,31 +121,34 @@ namespace eosiosystem {
             h.daycount = day_count+1;
             h.total_cpu_us = total_cpu_us;
             h.total_net_words = total_net_words;
-            h.net_percent_total = net_percent_total;
-            h.cpu_percent_total = cpu_percent_total;
-            h.use_cpu = usage_cpu;
-            h.use_net = usage_net;
-            h.ma_cpu = UTIL_CPU_MA;
-            h.ma_net = UTIL_NET_MA;
-            h.ema_cpu = raw_util_cpu_ema;
-            h.ema_net = raw_util_net_ema;
-            h.ema_util_total = UTIL_TOTAL_EMA;
-            h.utility = Upaygross;
-            h.utility_daily = utility_daily;
-            h.bppay = Bppay;
-            h.bppay_daily = bppay_daily;
-            h.inflation = inflation;
-            h.inflation_daily = Daily_i_U;
+            h.net_percent_total = (in.usage_net / usage_total).to_double();
+            h.cpu_percent_total = (in.usage_cpu / usage_total).to_double();
+            h.use_cpu = in.usage_cpu.to_double();
+            h.use_net = in.usage_net.to_double();
+            h.ma_cpu = out.ma_cpu.to_double();
+            h.ma_net = out.ma_net.to_double();
+            h.ema_cpu = out.ema_cpu.to_double();
+            h.ema_net = out.ema_net.to_double();
+            h.ema_util_total = out.ema_util_total.to_double();
+            h.utility = out.utility.to_double();
+            h.utility_daily = out.utility_daily.to_double();
+            h.bppay = out.bppay.to_double();
+            h.bppay_daily = out.bppay_daily.to_double();
+            h.inflation = out.inflation.to_double();
+            h.inflation_daily = out.inflation_daily.to_double();
             h.utility_tokens = utility_tokens;
             h.bppay_tokens = bppay_tokens;
         });
 
-        _resource_config.set( _resource_config_state, get_self() );
+        push_moving_average(ma, pk, in.usage_cpu, in.usage_net, out.ma_cpu, out.ma_net);
+        ma_singleton.set(ma, get_self());
+
+        _inflation_config.set( _inflation_config_state, get_self() );
     }
 
-    // called from settotalusg 
+    // called from issueinfl
     void system_contract::issue_inflation(time_point_sec period_start) {
-        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
+        auto _inflation_config_state = _inflation_config.get_or_create(_self, inflation_config_state{});
 
         system_usage_history_table u_t(get_self(), get_self().value);
         auto itr_u = u_t.end();
@@ -253,7 +170,7 @@ namespace eosiosystem {
          if (inflation > supply_remaining) {
 
             // reduce tokens bp and utiltity tokens proportionally
-            asset new_bppay_tokens = asset(static_cast<double>(itr_u->bppay_tokens.amount) / static_cast<double>(inflation.amount) * static_cast<double>(supply_remaining.amount), core_symbol());
+            asset new_bppay_tokens = asset(static_cast<int64_t>(static_cast<int128_t>(itr_u->bppay_tokens.amount) * supply_remaining.amount / inflation.amount), core_symbol());
             asset new_utility_tokens = supply_remaining - new_bppay_tokens;
 
             // update table data (token values only)
@@ -277,11 +194,7 @@ namespace eosiosystem {
             transfer_act.send(get_self(), upay_account, itr_u->utility_tokens, "usage daily");
          }
 
-         std::vector<name> active_producers;
-         auto idx = _producers.get_index<"prototalvote"_n>();
-         for( auto it = idx.cbegin(); it != idx.cend() && active_producers.size() < 21 && 0 < it->total_votes && it->active(); ++it ) {
-             active_producers.emplace_back(it->owner);
-         }
+         std::vector<name> active_producers = get_oracles();
 
         // check there are enough active producers
          auto active_producer_count = active_producers.size();
@@ -311,24 +224,30 @@ namespace eosiosystem {
              }
          }
 
-        _resource_config_state.last_period_inflation_print = period_start;
-        _resource_config.set( _resource_config_state, get_self() );
+        _inflation_config_state.last_period_inflation_print = period_start;
+        _inflation_config.set( _inflation_config_state, get_self() );
     }
 
 
-    ACTION system_contract::initresource(uint16_t dataset_batch_size, uint16_t oracle_consensus_threshold, time_point_sec period_start, uint32_t period_seconds, double initial_value_transfer_rate, double max_pay_constant)
+    // set the inflation model and write the first usage history row, run before eosio.oracle's initresource
+    // a chain which ran the oracle in eosio.system then runs initresource and migrateres, in that order
+    ACTION system_contract::initinfl(time_point_sec period_start, double initial_value_transfer_rate, double max_pay_constant)
     {
         require_auth(get_self());
 
-        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
-        _resource_config_state.dataset_batch_size = dataset_batch_size;
-        _resource_config_state.oracle_consensus_threshold = oracle_consensus_threshold;
-        _resource_config_state.period_start = period_start;
-        _resource_config_state.period_seconds = period_seconds;
-        _resource_config_state.initial_value_transfer_rate = initial_value_transfer_rate;
-        _resource_config_state.max_pay_constant = max_pay_constant;
-        _resource_config_state.last_period_inflation_print = time_point_sec();
-        _resource_config_state.active = false;
+        // keep the moving average window and last print from eosio.system's old resourceconf
+        inflation_config_state defaults{};
+        legacy_resource_config_singleton legacy(get_self(), get_self().value);
+        if (legacy.exists()) {
+            auto legacy_state = legacy.get();
+            defaults.emadraglimit = legacy_state.emadraglimit;
+            defaults.last_period_inflation_print = legacy_state.last_period_inflation_print;
+        }
+
+        auto _inflation_config_state = _inflation_config.get_or_create(_self, defaults);
+        _inflation_config_state.initial_value_transfer_rate = initial_value_transfer_rate;
+        _inflation_config_state.max_pay_constant = max_pay_constant;
+        _inflation_config_state.last_period_inflation_print = defaults.last_period_inflation_print;
 
         system_usage_history_table u_t(get_self(), get_self().value);
         if (u_t.begin() == u_t.end()) {
@@ -346,458 +265,159 @@ namespace eosiosystem {
                 u.utility_daily = 0;
                 u.bppay_daily = 0;
             });
-
-            // only remove submission state if no history
-            _resource_config_state.submitting_oracles = {};
-            _resource_config_state.inflation_transferred = false;
-            _resource_config_state.account_distributions_made = {};
-
         }
-        _resource_config.set( _resource_config_state, get_self() );
+        _inflation_config.set( _inflation_config_state, get_self() );
     }
 
-    // sets total resources used by system (for calling oracle)
-    // this must be called by oracle before adding individual cpu usage
-    ACTION system_contract::settotalusg(name source, uint64_t total_cpu_us, uint64_t total_net_words, checksum256 all_data_hash, time_point_sec period_start)
+    // records a period's usage totals and issues its inflation, sent inline by eosio.oracle once its oracles agreed on them
+    ACTION system_contract::issueinfl(uint64_t total_cpu_us, uint64_t total_net_words, time_point_sec period_start)
     {
-        require_auth(source);
-        check(is_oracle(source) == true, "not a qualified oracle");
-
-        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
-
-        check(_resource_config_state.active, "resource model not active");
-
-        check(_resource_config_state.period_start == period_start, "period_start does not match current period_start");
-
-        // check submissions are within system limits
-        uint64_t system_max_cpu = static_cast<uint64_t>(_gstate.max_block_cpu_usage) * 2 * 60 * 60 * 24;
-        check( total_cpu_us <= system_max_cpu, "measured cpu usage is greater than system total");
-        uint64_t system_max_net = static_cast<uint64_t>(_gstate.max_block_net_usage) * 2 * 60 * 60 * 24;
-        check( total_net_words * 8 <= system_max_net, "measured net usage is greater than system total");
-
-        system_usage_table u_t(get_self(), get_self().value);
-        auto itr = u_t.find(source.value);
-
-        check(itr == u_t.end(), "total already set");
-
-        // hash submitted data
-        std::string datatext = std::to_string(total_cpu_us) + "-" + std::to_string(total_net_words);
-        checksum256 hash = sha256(datatext.c_str(), datatext.size());
-        std::vector<metric> data {
-            {"cpu.us"_n, total_cpu_us},
-            {"net.words"_n, total_net_words}
-        };
-
-        // add data and hash to table if not already present
-        datasets_table d_t(get_self(), get_self().value);
-        auto dt_hash_index = d_t.get_index<"hash"_n>();
-        auto dt_itr = dt_hash_index.find(hash);
-        if (dt_itr->hash != hash) {
-            d_t.emplace(get_self(), [&](auto& t) {
-                t.id = d_t.available_primary_key();
-                t.hash = hash;
-                t.data = data;
-            });
-        }
-
-        // add totals data
-        u_t.emplace(source, [&](auto& t) {
-            t.source = source;
-            t.total_cpu_us = total_cpu_us;
-            t.total_net_words = total_net_words;
-            t.submission_hash_list.push_back(hash);
-            t.all_data_hash = all_data_hash;
-        });
-
-        _resource_config_state.submitting_oracles.push_back(source);
-
+        require_auth(oracle_account);
 
-        // distribute inflation (if it hasn't been done)
-        if (!_resource_config_state.inflation_transferred) {
-            std::map<checksum256, uint8_t> hash_count;
-            auto oracles = _resource_config_state.submitting_oracles;
-            if (oracles.size() >= _resource_config_state.oracle_consensus_threshold) {
-
-                // count number of each hash
-                system_usage_table u_t(get_self(), get_self().value);
-                for (int i=0; i<oracles.size(); i++) {
-                    auto ut_itr = u_t.begin();
-                    ut_itr = u_t.find(oracles[i].value);
-                    if (ut_itr->submission_hash_list.size() >= 1) {
-                        hash_count[ut_itr->submission_hash_list[0]]++;
-                    }
-                }
-
-                // establish modal hash
-                checksum256 modal_hash;
-                uint8_t mode_count = 0;
-                for (auto const& x : hash_count) {
-                    if (x.second > mode_count) {
-                        modal_hash = x.first;
-                        mode_count = x.second;
-                    }
-                }
-
-                // find dataset corresponding to modal hash, and distribute inflation
-                if (mode_count >= _resource_config_state.oracle_consensus_threshold) {
-                    std::vector<metric> accounts_usage_data;
-                    datasets_table d_t(get_self(), get_self().value);
-                    auto dt_hash_index = d_t.get_index<"hash"_n>();
-                    auto dt_itr = dt_hash_index.find(modal_hash);
-                    if (dt_itr->hash == modal_hash) {
-                        auto cpu_usage_us = dt_itr->data[0].u;
-                        auto net_usage_words = dt_itr->data[1].u;
-                        set_total(cpu_usage_us, net_usage_words, period_start);
-                        issue_inflation(period_start);
-                        _resource_config_state.inflation_transferred = true;
-                    }
-
-                }
-
-            }
-
-        } // end of inflation distribution
+        system_usage_history_table u_t(get_self(), get_self().value);
+        check(u_t.begin() != u_t.end(), "resource inflation not initialised");
+        auto itr = u_t.end();
+        itr--;
+        check(period_start > itr->timestamp || itr->daycount == 0, "inflation already issued for period");
 
-        _resource_config.set( _resource_config_state, get_self() );
+        set_total(total_cpu_us, total_net_words, period_start);
+        issue_inflation(period_start);
     }
 
-    // adds the CPU used by the accounts included (for calling oracle)
-    // called after the oracle has set the total
-    ACTION system_contract::addactusg(name source, uint16_t dataset_id, const std::vector<metric>& dataset, time_point_sec period_start)
-    {  
-        require_auth(source);
-        check(is_oracle(source) == true, "not a qualified oracle");
-
-        int length = dataset.size();
-
-        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
-
-        check(_resource_config_state.active, "resource model not active");
+    // set the moving average window in periods, the rolling sums are rebuilt here once rather than during set_total
+    ACTION system_contract::setdraglimit(uint32_t emadraglimit) {
+        require_auth(get_self());
 
-        check(length<=_resource_config_state.dataset_batch_size, "must supply fewer dataset values");
-        check(_resource_config_state.period_start == period_start, "period_start does not match current period_start");
+        check(emadraglimit > 0 && emadraglimit <= 255, "emadraglimit must be between 1 and 255");
 
-        check(_resource_config_state.inflation_transferred == true, "inflation not yet transferred");
+        auto _inflation_config_state = _inflation_config.get_or_create(_self, inflation_config_state{});
+        _inflation_config_state.emadraglimit = emadraglimit;
+        _inflation_config.set( _inflation_config_state, get_self() );
 
-        system_usage_table u_t(get_self(), get_self().value);
-        auto ut_itr = u_t.find(source.value);
-        check(ut_itr != u_t.end(), "usage totals not set");
-        check(dataset_id == ut_itr->submission_hash_list.size(), "dataset_id differs from expected value");
+        system_usage_history_table u_t(get_self(), get_self().value);
+        moving_average_singleton ma_singleton(get_self(), get_self().value);
+        moving_average_state ma;
+        rebuild_moving_average(ma, u_t, emadraglimit - 1);
+        ma_singleton.set(ma, get_self());
+    }
 
-        std::string datatext = "";
-        for (int i=0; i<length; i++) {
-            auto account = dataset[i].a;
-            auto cpu_usage_us = dataset[i].u;
-            check(cpu_usage_us > 0, "account cpu measurement must be greater than 0");
+    // move up to max_rows of the resaccpay balances and ressources scores eosio.system held before eosio.oracle into it,
+    // then erase its other oracle tables within what is left of max_rows, and its old resourceconf once they are empty
+    // eosio.upay already holds the balances, only the rows move, run until it reports none left
+    ACTION system_contract::migrateres(uint16_t max_rows) {
+        require_auth(get_self());
 
-            // add cpu to allocated amount for oracle to ensure not exceeding declared total
-            auto unallocated_cpu = ut_itr->total_cpu_us - ut_itr->allocated_cpu;
-            check(unallocated_cpu >= cpu_usage_us, "insufficient unallocated cpu");
-            u_t.modify(ut_itr, source, [&](auto& t) {
-                t.allocated_cpu += cpu_usage_us;
-            });
+        check(max_rows > 0, "max_rows must be greater than 0");
+        check(_inflation_config.exists(), "run initinfl before migrateres");
 
-            // append usage pair to string for hashing
-            datatext += account.to_string();
-            datatext += std::to_string(cpu_usage_us);
+        std::vector<legacy_account_pay> pays;
+        legacy_account_pay_table ap_t(get_self(), get_self().value);
+        for (auto itr = ap_t.begin(); itr != ap_t.end() && pays.size() < max_rows;) {
+            pays.push_back(*itr);
+            itr = ap_t.erase(itr);
         }
 
-        // hash submitted dataset
-        checksum256 hash = sha256(datatext.c_str(), datatext.size());
-        u_t.modify(ut_itr, source, [&](auto& t) {
-            t.submission_hash_list.push_back(hash);
-        });
-
-        // add data and hash to table if not already present
-        datasets_table d_t(get_self(), get_self().value);
-        auto dt_hash_index = d_t.get_index<"hash"_n>();
-        auto dt_itr = dt_hash_index.find(hash);
-        if (dt_itr->hash != hash) {
-            d_t.emplace(source, [&](auto& t) {
-                t.id = d_t.available_primary_key();
-                t.hash = hash;
-                t.data = dataset;
-            });
+        std::vector<legacy_sources> scores;
+        legacy_sources_table s_t(get_self(), get_self().value);
+        for (auto itr = s_t.begin(); itr != s_t.end() && pays.size() + scores.size() < max_rows;) {
+            scores.push_back(*itr);
+            itr = s_t.erase(itr);
         }
 
-        // distribute user account rewards
-        std::map<checksum256, uint8_t> hash_count;
-        auto oracles = _resource_config_state.submitting_oracles;
-        if (oracles.size() >= _resource_config_state.oracle_consensus_threshold) {
-
-            // count number of each hash
-            system_usage_table u_t(get_self(), get_self().value);
-            for (int i=0; i<oracles.size(); i++) {
-                auto ut_itr = u_t.begin();
-                ut_itr = u_t.find(oracles[i].value);
-                if (ut_itr->submission_hash_list.size() >= (dataset_id+1)) {
-                    hash_count[ut_itr->submission_hash_list[dataset_id]]++;
-                }
-            }
-
-            // establish modal hash
-            checksum256 modal_hash;
-            uint8_t mode_count = 0;
-            for (auto const& x : hash_count) {
-                if (x.second > mode_count) {
-                    modal_hash = x.first;
-                    mode_count = x.second;
-                }
-            }
-
-            // find dataset corresponding to modal hash, and distribute inflation if not done
-            auto v = _resource_config_state.account_distributions_made;
-            if (std::find(v.begin(), v.end(), dataset_id) == v.end()) {
-
-                if (mode_count >= _resource_config_state.oracle_consensus_threshold) {
-                    std::vector<metric> accounts_usage_data;
-                    datasets_table d_t(get_self(), get_self().value);
-                    auto dt_hash_index = d_t.get_index<"hash"_n>();
-                    auto dt_itr = dt_hash_index.find(modal_hash);
-                    if (dt_itr->hash == modal_hash) {
-                        accounts_usage_data = dt_itr->data;
-                    }
-
-                    // get total_cpu from last system_usage_history record
-                    system_usage_history_table suh_t(get_self(), get_self().value);
-                    auto suh_itr = suh_t.end();
-                    suh_itr--;
-                    auto total_cpu = suh_itr->total_cpu_us;
-                    auto utility_tokens_amount = suh_itr->utility_tokens.amount;
-
-                    // expensive part (100 accounts in ~9000us)
-                    auto core_sym = core_symbol();
-                    account_pay_table ap_t(get_self(), get_self().value);
-                    for (int i=0; i<accounts_usage_data.size(); i++) {
-                        auto account = accounts_usage_data[i].a;
-                        auto account_cpu = accounts_usage_data[i].u;
-                        auto add_claim = (static_cast<double>(account_cpu) / total_cpu) * utility_tokens_amount;
-                        asset payout = asset(add_claim, core_symbol());
-                        auto ap_itr = ap_t.find(account.value);
-                        if (ap_itr == ap_t.end()) {
-                            ap_t.emplace(get_self(), [&](auto& t) {
-                                t.account = account;
-                                t.balance = payout;
-                                t.timestamp = period_start;
-                            });
-                        } else {
-                            ap_t.modify(ap_itr, get_self(), [&](auto& t) {
-                                t.balance += payout;
-                                t.timestamp = period_start;
-                            });
-                        }
-
-                    }
-                    _resource_config_state.account_distributions_made.push_back(dataset_id);
-                }
-            } // end of account distributions
-
+        uint32_t erased = pays.size() + scores.size();
 
+        // the period tables were scoped by eosio, later by the period they report on, of which the open one and the next hold rows
+        legacy_resource_config_singleton legacy(get_self(), get_self().value);
+        std::vector<uint64_t> scopes = {get_self().value};
+        if (legacy.exists()) {
+            auto legacy_state = legacy.get();
+            uint64_t period_scope = legacy_state.period_start.sec_since_epoch();
+            scopes.push_back(period_scope);
+            scopes.push_back(period_scope + legacy_state.period_seconds);
         }
-
-        _resource_config.set( _resource_config_state, get_self() );
-    }
-
-    // called by anyone from 48hrs after the current period start
-    // clears tables and advances period start
-    ACTION system_contract::nextperiod()
-    {
-        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
-
-        check(_resource_config_state.active, "resource model not active");
-
-        auto current_seconds = current_time_point().sec_since_epoch();
-        auto period_start_seconds = _resource_config_state.period_start.sec_since_epoch();
-        check(current_seconds >= (period_start_seconds + (_resource_config_state.period_seconds)), "current resource period has not ended");
-        if (current_seconds >= (period_start_seconds + (_resource_config_state.period_seconds))) {
-
-            // erase records ready for next periods submissions
-            datasets_table d_t(get_self(), get_self().value);
-            auto dt_itr = d_t.begin();
-            while (dt_itr != d_t.end()) {
-                dt_itr = d_t.erase(dt_itr);
-            }
-
-            system_usage_table u_t(get_self(), get_self().value);
-
-            auto oracles = _resource_config_state.submitting_oracles;
-
-            // find modal all_data_hash
-            std::map<checksum256, uint8_t> hash_count;
-            checksum256 modal_hash;
-            uint8_t mode_count = 0;
-            if (oracles.size() >= _resource_config_state.oracle_consensus_threshold) {
-                // count number of each hash
-                for (int i=0; i<oracles.size(); i++) {
-                    auto ut_itr = u_t.begin();
-                    ut_itr = u_t.find(oracles[i].value);
-                    hash_count[ut_itr->all_data_hash]++;
-                }
-                // establish modal hash
-                for (auto const& x : hash_count) {
-                    if (x.second > mode_count) {
-                        modal_hash = x.first;
-                        mode_count = x.second;
-                    }
-                }
-            }
-
-            // score and reward submissions based on commitment hash and modal agreement
-            auto core_sym = core_symbol();
-            account_pay_table ap_t(get_self(), get_self().value);
-
-            auto oracle_full_data_mode_count = 0;
-
-            for (int i=0; i<oracles.size(); i++) {
-                auto ut_itr = u_t.begin();
-                ut_itr = u_t.find(oracles[i].value);
-
-                std::string datatext = "";
-                for (int ii=0; ii<ut_itr->submission_hash_list.size(); ii++) {
-                    checksum256 hash = ut_itr->submission_hash_list[ii];
-                    datatext += to_hex(hash.extract_as_byte_array().data(), sizeof(hash));
-                    if (ii < ut_itr->submission_hash_list.size()-1) {
-                        datatext += "-";
-                    }
-                }
-
-                if (mode_count >= _resource_config_state.oracle_consensus_threshold) {
-                    uint64_t oracle_points = 0;
-                    checksum256 commit_hash = ut_itr->all_data_hash;
-                    checksum256 reveal_hash = sha256(datatext.c_str(), datatext.size());
-                    if (reveal_hash == commit_hash) {
-                        oracle_points = 1; // data is as declared
-                        if ((commit_hash == modal_hash) && (mode_count >= _resource_config_state.oracle_consensus_threshold)) {
-                            oracle_points += 9; // data is same as modal data
-                            oracle_full_data_mode_count += 1;
-                        }
-                    }
-
-                    // add/modify score in sources table
-                    sources_table s_t(get_self(), get_self().value);
-                    auto st_itr = s_t.find(oracles[i].value);
-                    if (st_itr == s_t.end()) {
-                        s_t.emplace(get_self(), [&](auto& t) {
-                            t.account = oracles[i];
-                            t.submissions_score = oracle_points;
-                            t.submissions_count = 1;
-                        });
-                    } else {
-                        s_t.modify(st_itr, get_self(), [&](auto& t) {
-                            t.submissions_score += oracle_points;
-                            t.submissions_count += 1;
-                        });
-                    }
-
-                    // // todo - add oracle payment in future version
-                    // auto amount = 0;
-                    // asset payout = asset(amount, core_symbol());
-                    // auto ap_itr = ap_t.find(oracles[i].value);
-                    // if (ap_itr == ap_t.end()) {
-                    //     ap_t.emplace(get_self(), [&](auto& t) {
-                    //         t.account = oracles[i];
-                    //         t.balance = payout;
-                    //         t.timestamp = _resource_config_state.period_start;
-                    //     });
-                    // } else {
-                    //     ap_t.modify(ap_itr, get_self(), [&](auto& t) {
-                    //         t.balance += payout;
-                    //         t.timestamp = _resource_config_state.period_start;
-                    //     });
-                    // }
-
-                }
-            }
-
-            // prevent period advancing if no modal data was received
-            check(oracle_full_data_mode_count >= _resource_config_state.oracle_consensus_threshold, "full modal data not received");
-
-            // erase records ready for next periods submissions
-            auto ut_itr = u_t.begin();
-            while (ut_itr != u_t.end()) {
-                ut_itr = u_t.erase(ut_itr);
-            }
-
-            _resource_config_state.submitting_oracles.clear();
-            _resource_config_state.period_start = time_point_sec(_resource_config_state.period_start.sec_since_epoch() + _resource_config_state.period_seconds);
-            _resource_config_state.inflation_transferred = false;
-            _resource_config_state.account_distributions_made.clear();
+        for (auto scope : scopes) {
+            legacy_system_usage_table su_t(get_self(), scope);
+            erased += erase_rows(su_t, max_rows - erased);
+            legacy_datasets_table d_t(get_self(), scope);
+            erased += erase_rows(d_t, max_rows - erased);
+            legacy_consensus_table c_t(get_self(), scope);
+            erased += erase_rows(c_t, max_rows - erased);
+            legacy_dataset_distribution_table dist_t(get_self(), scope);
+            erased += erase_rows(dist_t, max_rows - erased);
         }
+        legacy_claim_root_table cr_t(get_self(), get_self().value);
+        erased += erase_rows(cr_t, max_rows - erased);
 
-        _resource_config.set( _resource_config_state, get_self() );
-    }
-
-    // called by individual accounts to claim their distribution
-    ACTION system_contract::claimdistrib(name account)
-    {
-        require_auth(account);
-
-        account_pay_table a_t(get_self(), get_self().value);
-        auto itr = a_t.find(account.value);
-        check(itr != a_t.end(), "account balance not found");
-        check(itr->balance != asset( 0, core_symbol() ), "no balance to claim");
+        // initresource reads the old resourceconf, so it goes last, once nothing else is left
+        if (erased < max_rows && legacy.exists()) {
+            legacy.remove();
+            erased++;
+        }
+        check(erased > 0, "no legacy resource rows left");
 
-        token::transfer_action transfer_act{token_account, {{upay_account, active_permission}, {account, active_permission}}};
-        transfer_act.send(upay_account, account, itr->balance, "utility reward");
-        itr = a_t.erase(itr);
+        if (!pays.empty() || !scores.empty()) {
+            action(permission_level{get_self(), active_permission}, oracle_account, "importres"_n, std::make_tuple(scores, pays)).send();
+        }
     }
 
-    // activate/deactivate resource model inflation
-    ACTION system_contract::resactivate(bool active) {
+    // let onblock roll the eosio.oracle period over, clearing at most rollover_rows rows per step, 0 turns it off
+    ACTION system_contract::setrollover(uint16_t rollover_rows) {
         require_auth(get_self());
 
-        auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
+        auto _inflation_config_state = _inflation_config.get_or_create(_self, inflation_config_state{});
+        _inflation_config_state.rollover_rows.emplace(rollover_rows);
+        _inflation_config.set( _inflation_config_state, get_self() );
+    }
 
-        // check active state isn't already as requested
-        if (active) {
-            check(!_resource_config_state.active, "resource model already active");
-        } else {
-            check(_resource_config_state.active, "resource model already inactive");
+    // called from onblock, schedules one bounded eosio.oracle rollover step when the step can make progress
+    // a rollover under way clears or queues rows with every step, so it gets one each block
+    // an ended period may be waiting for its modal data, so its steps get further apart the longer it has waited
+    // the step runs in a transaction of its own, so an assert in it or in the issueinfl it sends never fails the block's onblock
+    void system_contract::step_oracle_rollover() {
+        if (!_inflation_config.exists()) return;
+        auto _inflation_config_state = _inflation_config.get();
+        uint16_t rollover_rows = *_inflation_config_state.rollover_rows;
+        if (rollover_rows == 0) return;
+
+        resource_config_singleton rc(oracle_account, oracle_account.value);
+        if (!rc.exists()) return;
+        auto conf = rc.get();
+        if (!conf.active) return;
+
+        if (conf.rollover_stage == 0) {
+            uint32_t now = current_time_point().sec_since_epoch();
+            uint32_t period_end = conf.period_start.sec_since_epoch() + conf.period_seconds;
+            if (now < period_end || now < _inflation_config_state.next_rollover_step->sec_since_epoch()) return;
+
+            uint32_t interval = std::min(std::max((now - period_end) / 4, 1u), max_rollover_interval);
+            _inflation_config_state.next_rollover_step.emplace(time_point_sec(now + interval));
+            _inflation_config.set( _inflation_config_state, get_self() );
         }
 
-        _resource_config_state.active = active;
-        _resource_config.set( _resource_config_state, get_self() );
+        // refunds use the account as id and name bids cannot hold a dot, so this id is free
+        eosio::transaction t;
+        t.actions.emplace_back(permission_level{get_self(), active_permission}, oracle_account, "rollover"_n, std::make_tuple(rollover_rows));
+        t.delay_sec = 0;
+        uint128_t deferred_id = (uint128_t(oracle_account.value) << 64) | "rollover"_n.value;
+        eosio::cancel_deferred(deferred_id);
+        t.send(deferred_id, get_self());
     }
 
     #ifdef INCLUDECLEARACTIONS
         ACTION system_contract::clrresource() {
             require_auth(get_self());
 
-            auto _resource_config_state = _resource_config.get_or_create(_self, resource_config_state{});
-            check(!_resource_config_state.active, "must deactivate before clearing");
-
             system_usage_history_table uh_t(get_self(), get_self().value);
             auto uh_itr = uh_t.begin();
             while (uh_itr != uh_t.end()) {
                 uh_itr = uh_t.erase(uh_itr);
             }
 
-            datasets_table d_t(get_self(), get_self().value);
-            auto dt_itr = d_t.begin();
-            while (dt_itr != d_t.end()) {
-                dt_itr = d_t.erase(dt_itr);
-            }
-
-            account_pay_table a_t(get_self(), get_self().value);
-            auto a_itr = a_t.begin();
-            while (a_itr != a_t.end()) {
-                a_itr = a_t.erase(a_itr);
-            }
-
-            system_usage_table u_t(get_self(), get_self().value);
-            auto u_itr = u_t.begin();
-            while (u_itr != u_t.end()) {
-                u_itr = u_t.erase(u_itr);
-            }
-
-            sources_table s_t(get_self(), get_self().value);
-            auto s_itr = s_t.begin();
-            while (s_itr != s_t.end()) {
-                s_itr = s_t.erase(s_itr);
-            }
+            moving_average_singleton ma_singleton(get_self(), get_self().value);
+            if (ma_singleton.exists()) ma_singleton.remove();
 
-            if (_resource_config.exists()) _resource_config.remove();
+            if (_inflation_config.exists()) _inflation_config.remove();
         }
     #endif
 
-}
\ No newline at end of file
+}
@@ -148,9 +148,20 @@ namespace eosiosystem {
       for( auto& item : top_producers )
          producers.push_back( std::move(item.first) );
 
-      if( set_proposed_producers( producers ) >= 0 ) {
+      bool proposed = set_proposed_producers( producers ) >= 0;
+      if( proposed ) {
          _gstate.last_producer_schedule_size = static_cast<decltype(_gstate.last_producer_schedule_size)>( top_producers.size() );
       }
+
+      // snapshot the oracle set, a rejected proposal is identical to the current schedule so it still seeds the cache
+      oracle_set_singleton oracle_cache( get_self(), get_self().value );
+      if( proposed || !oracle_cache.exists() ) {
+         oracle_set cached;
+         cached.oracles.reserve( producers.size() );
+         for( const auto& p : producers )
+            cached.oracles.push_back( p.producer_name );
+         oracle_cache.set( cached, get_self() );
+      }
    }
 
    double stake2vote( int64_t staked ) {
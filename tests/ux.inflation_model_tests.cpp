@@ -0,0 +1,185 @@
+#include <boost/test/unit_test.hpp>
+#include <eosio.system/inflation_model.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+   // the double precision model set_total used before the fixed point kernel, kept as the reference
+   struct reference_row
+   {
+      double use_cpu = 0, use_net = 0, ma_cpu = 0, ma_net = 0, ema_cpu = 0, ema_net = 0;
+      double inflation = 0, inflation_daily = 0, utility_daily = 0, bppay_daily = 0, cpu_pay = 0, final_bp_daily = 0;
+   };
+
+   reference_row reference_period(const std::vector<reference_row> &history, uint64_t draglimit, double usage_cpu, double usage_net,
+                                  double initial_value_transfer_rate, double MP)
+   {
+      auto calcMA = [](double sum, uint8_t timeperiod, double newVal) { return (sum + newVal) / (timeperiod); };
+      auto calcEMA = [](double previousAverage, int timePeriod, double newVal) { return (newVal - previousAverage) * (2.0 / (timePeriod + 1.0)) + previousAverage; };
+      auto get_c = [](double x) { return -x * log(x) * exp(1); };
+
+      uint64_t day_count = history.size() - 1;
+      double VT = pow(2, -(static_cast<double>(day_count) / 365)) * initial_value_transfer_rate;
+      if (usage_cpu < 0.00000000001)
+         usage_cpu = 0.00000000001;
+      if (usage_net < 0.00000000001)
+         usage_net = 0.00000000001;
+
+      double ma_cpu_total = 0.0;
+      double ma_net_total = 0.0;
+      for (uint64_t i = 1; i < draglimit && i <= history.size(); i++)
+      {
+         ma_cpu_total += history[history.size() - i].use_cpu;
+         ma_net_total += history[history.size() - i].use_net;
+      }
+      uint8_t period = day_count < draglimit ? day_count + 1 : draglimit;
+
+      reference_row r;
+      r.use_cpu = usage_cpu;
+      r.use_net = usage_net;
+      r.ma_cpu = calcMA(ma_cpu_total, period, usage_cpu);
+      r.ma_net = calcMA(ma_net_total, period, usage_net);
+      if (history.size() >= draglimit)
+      {
+         r.ema_cpu = calcEMA(history.back().ma_cpu, draglimit, usage_cpu);
+         r.ema_net = calcEMA(history.back().ma_net, draglimit, usage_net);
+      }
+      else
+      {
+         r.ema_cpu = r.ma_cpu;
+         r.ema_net = r.ma_net;
+      }
+
+      double UTIL_CPU_EMA = r.ema_cpu / 2;
+      double UTIL_NET_EMA = r.ema_net / 2;
+      double UTIL_TOTAL_EMA = (UTIL_CPU_EMA + UTIL_NET_EMA);
+      if (UTIL_TOTAL_EMA < 0.00000000001)
+      {
+         UTIL_CPU_EMA = UTIL_CPU_EMA / UTIL_TOTAL_EMA * 0.00000000001;
+         UTIL_NET_EMA = UTIL_NET_EMA / UTIL_TOTAL_EMA * 0.00000000001;
+         UTIL_TOTAL_EMA = 0.00000000001;
+      }
+      if (UTIL_TOTAL_EMA > 0.99999999999)
+      {
+         UTIL_CPU_EMA = UTIL_CPU_EMA / UTIL_TOTAL_EMA * 0.99999999999;
+         UTIL_NET_EMA = UTIL_NET_EMA / UTIL_TOTAL_EMA * 0.99999999999;
+         UTIL_TOTAL_EMA = 0.99999999999;
+      }
+
+      double inflation = (1 - UTIL_TOTAL_EMA) / (1 - UTIL_TOTAL_EMA - get_c(UTIL_TOTAL_EMA) * VT) - 1;
+      double BP_U = MP * get_c(UTIL_TOTAL_EMA);
+      double Upaygross = pow((1 + inflation), (1 - BP_U)) - 1;
+      double Bppay = inflation - Upaygross;
+      double Waterfall_bp = inflation * (1 - UTIL_TOTAL_EMA);
+      double Bppay_final = fmin(Bppay, Waterfall_bp);
+      double Uppaynet = inflation - Bppay_final;
+      double Daily_i_U = pow(1 + inflation, static_cast<double>(1) / 365) - 1;
+      double utility_daily = (Uppaynet / inflation) * Daily_i_U;
+      double CPU_Pay = utility_daily * (UTIL_CPU_EMA / UTIL_TOTAL_EMA);
+      double NET_pay = utility_daily - CPU_Pay;
+      double bppay_daily = (Bppay_final / inflation) * Daily_i_U;
+
+      r.inflation = inflation;
+      r.inflation_daily = Daily_i_U;
+      r.utility_daily = utility_daily;
+      r.bppay_daily = bppay_daily;
+      r.cpu_pay = CPU_Pay;
+      r.final_bp_daily = bppay_daily + NET_pay;
+      return r;
+   }
+
+   // relative agreement, with an absolute allowance for values near the usage floor
+   void require_close(double expected, ux::fixed actual)
+   {
+      BOOST_REQUIRE_LE(std::fabs(expected - actual.to_double()), std::fabs(expected) * 1e-9 + 1e-15);
+   }
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(ux_inflation_model_tests)
+
+BOOST_AUTO_TEST_CASE(fixed_point_functions)
+{
+   for (double x : {1e-6, 0.001, 0.1, 0.5, 0.999, 1.0, 1.5, 3.7, 100.0})
+   {
+      ux::fixed f = ux::fixed::from_double(x);
+      BOOST_REQUIRE_LE(std::fabs(ux::log2(f).to_double() - std::log2(x)), 1e-12);
+      BOOST_REQUIRE_LE(std::fabs(ux::ln(f).to_double() - std::log(x)), 1e-12);
+   }
+   for (double x : {-30.0, -3.7, -1.0, -0.001, 0.0, 0.001, 0.5, 1.0, 10.25})
+   {
+      ux::fixed f = ux::fixed::from_double(x);
+      BOOST_REQUIRE_LE(std::fabs(ux::exp2(f).to_double() - std::exp2(x)), std::exp2(x) * 1e-15);
+   }
+   BOOST_REQUIRE_LE(std::fabs(ux::pow(ux::fixed::from_double(1.05), ux::fixed::from_ratio(1, 365)).to_double() - std::pow(1.05, 1.0 / 365)), 1e-16);
+   BOOST_REQUIRE_EQUAL(-8.125, (ux::fixed::from_double(-2.5) * ux::fixed::from_double(3.25)).to_double());
+   BOOST_REQUIRE_EQUAL(-2, (ux::fixed::from_int(-5) / ux::fixed::from_double(2.5)).to_int());
+   BOOST_REQUIRE_EQUAL(std::exp(1.0), ux::fixed_e.to_double());
+}
+
+// run the whole 1096 day inflation window for a range of utilisations and drag limits
+BOOST_AUTO_TEST_CASE(matches_double_model)
+{
+   const uint64_t capacity = 200000ull * 2 * 60 * 60 * 24;
+   const int64_t supply = 16392589380000;
+
+   for (double target : {0.0, 0.1, 0.5, 0.8, 1.0})
+   {
+      for (uint64_t draglimit : {2, 30, 90})
+      {
+         std::vector<reference_row> history(1);
+         std::vector<ux::fixed> cpu_samples(1), net_samples(1);
+         ux::fixed previous_ma_cpu, previous_ma_net;
+         uint64_t seed = 12345;
+
+         for (uint64_t day = 0; day < 1096; day++)
+         {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            double jitter = static_cast<double>(seed >> 40) / (1 << 24);
+            uint64_t used_cpu = std::min<uint64_t>(capacity, capacity * target * (0.9 + 0.2 * jitter));
+            uint64_t used_net = capacity * target * 0.4;
+
+            reference_row expected = reference_period(history, draglimit, double(used_cpu) / capacity, double(used_net) / capacity, 0.1, 0.2947);
+
+            ux::inflation_inputs in;
+            in.day_count = day;
+            in.history_count = history.size();
+            in.draglimit = draglimit;
+            in.usage_cpu = ux::usage_fraction(used_cpu, capacity);
+            in.usage_net = ux::usage_fraction(used_net, capacity);
+            for (uint64_t i = 1; i < draglimit && i <= cpu_samples.size(); i++)
+            {
+               in.ma_cpu_total = in.ma_cpu_total + cpu_samples[cpu_samples.size() - i];
+               in.ma_net_total = in.ma_net_total + net_samples[net_samples.size() - i];
+            }
+            in.previous_ma_cpu = previous_ma_cpu;
+            in.previous_ma_net = previous_ma_net;
+            in.initial_value_transfer_rate = ux::fixed::from_double(0.1);
+            in.max_pay_constant = ux::fixed::from_double(0.2947);
+
+            ux::inflation_outputs out = ux::compute_inflation(in);
+
+            require_close(expected.ma_cpu, out.ma_cpu);
+            require_close(expected.ema_cpu, out.ema_cpu);
+            require_close(expected.ema_net, out.ema_net);
+            require_close(expected.inflation, out.inflation);
+            require_close(expected.inflation_daily, out.inflation_daily);
+            require_close(expected.utility_daily, out.utility_daily);
+            require_close(expected.bppay_daily, out.bppay_daily);
+
+            // issued amounts may only differ by the final unit
+            BOOST_REQUIRE_LE(std::llabs((out.cpu_pay * supply).to_int() - static_cast<int64_t>(expected.cpu_pay * double(supply))), 1);
+            BOOST_REQUIRE_LE(std::llabs((out.final_bp_daily * supply).to_int() - static_cast<int64_t>(expected.final_bp_daily * double(supply))), 1);
+
+            history.push_back(expected);
+            cpu_samples.push_back(in.usage_cpu);
+            net_samples.push_back(in.usage_net);
+            previous_ma_cpu = out.ma_cpu;
+            previous_ma_net = out.ma_net;
+         }
+      }
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
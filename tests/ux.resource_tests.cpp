@@ -8,9 +8,14 @@
 #include <Runtime/Runtime.h>
 
 #include "ux.system_tester.hpp"
+#include <ux.aggregator/aggregator.hpp>
+#include <ux.simulator/simulator.hpp>
 
 #include <time.h>
 #include <ctime>
+#include <numeric>
+#include <set>
+#include <sstream>
 
 using namespace eosio_system;
 
@@ -83,7 +88,7 @@ try
    // Test Fail on wrong period start
    long period_start_sec_bad = getSecondsSinceEpochUTC("2020-10-01 01:00:00");
    time_point_sec period_start_bad = time_point_sec(period_start_sec_bad);
-   BOOST_REQUIRE_EQUAL(wasm_assert_msg("period_start does not match current period_start"),
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("period_start does not match an open period"),
                        addactusg(N(defproducera), 1, usage_data_50.usage_datasets[1], period_start_bad));
 
    for (int i = 0; i < usage_data_50.usage_datasets.size(); i++)
@@ -110,8 +115,9 @@ try
    BOOST_TEST(get_balance(N(eosio.upay)).get_amount() == 4689364296);
    
 
-   // Test fail on account overage
-   BOOST_REQUIRE_EQUAL(wasm_assert_msg("insufficient unallocated cpu"), addactusg(N(defproducera), 3, usage_data_50.usage_datasets[1], period_start));
+   // Test fail on account overage, the account follows the oracle's last one so only the cpu check rejects it
+   vector<fc::variant> overage = {mvo()("a", "zzzzzzzzzzzz")("u", 1)};
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("insufficient unallocated cpu"), addactusg(N(defproducera), 3, overage, period_start));
 
    produce_blocks(2);
 
@@ -275,6 +281,1591 @@ try
 }
 FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE(resource_commitment, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   // jump to UX start date
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+
+   // activate chain and vote for producers
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   time_point_sec period_start = time_point_sec(period_start_sec);
+
+   uint16_t dataset_batch_size = 1;
+   uint16_t oracle_consensus_threshold = 2;
+   uint32_t period_seconds = 60 * 60 * 24;
+   float initial_value_transfer_rate = 0.1;
+   float max_pay_constant = 0.2947;
+
+   initresource(dataset_batch_size, oracle_consensus_threshold, period_start, period_seconds, initial_value_transfer_rate, max_pay_constant);
+   resactivate(true);
+   produce_blocks(2);
+
+   // totals plus 10 single row datasets gives an unbalanced merkle tree of 11 leaves
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_75.json");
+   struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, dataset_batch_size);
+   struct oracle_data usage_data_batched = generate_all_data_hash(usage_data_vo, 3);
+   BOOST_REQUIRE(usage_data.all_data_hash != usage_data_batched.all_data_hash);
+
+   // defproducerb commits to a root which does not match the data it later reveals
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducera), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducerb), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data_batched.all_data_hash, period_start));
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducerc), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+
+   for (int i = 0; i < usage_data.usage_datasets.size(); i++)
+   {
+      BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducera), i + 1, usage_data.usage_datasets[i], period_start));
+      BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerb), i + 1, usage_data.usage_datasets[i], period_start));
+      BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerc), i + 1, usage_data.usage_datasets[i], period_start));
+   }
+
+   skipAhead(getSecondsSinceEpochUTC("2020-10-02 00:00:00"));
+   BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducera)));
+
+   // revealed data matching the modal commitment scores 10, a broken commitment scores nothing
+   BOOST_REQUIRE_EQUAL(10, sources_table_info(N(defproducera))["submissions_score"].as_uint64());
+   BOOST_REQUIRE_EQUAL(0, sources_table_info(N(defproducerb))["submissions_score"].as_uint64());
+   BOOST_REQUIRE_EQUAL(10, sources_table_info(N(defproducerc))["submissions_score"].as_uint64());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_hash_version, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   // jump to UX start date
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+
+   // activate chain and vote for producers
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   time_point_sec period_start = time_point_sec(period_start_sec);
+
+   uint16_t dataset_batch_size = 5;
+   uint16_t oracle_consensus_threshold = 1;
+   uint32_t period_seconds = 60 * 60 * 24;
+   float initial_value_transfer_rate = 0.1;
+   float max_pay_constant = 0.2947;
+
+   initresource(dataset_batch_size, oracle_consensus_threshold, period_start, period_seconds, initial_value_transfer_rate, max_pay_constant);
+   resactivate(true);
+   produce_blocks(2);
+
+   BOOST_REQUIRE_EQUAL(1, resource_conf_info()["hash_version"].as_uint64());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("unsupported hash version"), sethashver(2));
+
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_50.json");
+   struct oracle_data text_data = generate_all_data_hash(usage_data_vo, dataset_batch_size, 1, 0);
+   struct oracle_data binary_data = generate_all_data_hash(usage_data_vo, dataset_batch_size, 1, 1);
+   BOOST_REQUIRE(text_data.all_data_hash != binary_data.all_data_hash);
+
+   // legacy text hashing for the first period
+   BOOST_REQUIRE_EQUAL(success(), sethashver(0));
+   dayCycle("./tests/usage_data/usage_data_50.json", period_start_sec, dataset_batch_size, 0);
+
+   // format is fixed once submissions are open
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("cannot change hash version while submissions are open"), sethashver(1));
+
+   period_start_sec += period_seconds;
+   skipAhead(period_start_sec);
+   BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducerb)));
+
+   // packed binary hashing for the second period
+   BOOST_REQUIRE_EQUAL(success(), sethashver(1));
+   dayCycle("./tests/usage_data/usage_data_50.json", period_start_sec, dataset_batch_size, 1);
+
+   period_start_sec += period_seconds;
+   skipAhead(period_start_sec);
+   BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducerb)));
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_legacy_hash_version, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   time_point_sec period_start = time_point_sec(period_start_sec);
+   uint16_t dataset_batch_size = 5;
+   uint32_t period_seconds = 60 * 60 * 24;
+
+   // a resourceconf from before hash_version was appended, its oracles hash as text
+   set_legacy_resource_config(period_start, false);
+   produce_block();
+   initresource(dataset_batch_size, 1, period_start, period_seconds, 0.1, 0.2947);
+   BOOST_REQUIRE_EQUAL(success(), resactivate(true));
+   produce_blocks(2);
+   BOOST_REQUIRE_EQUAL(0, resource_conf_info()["hash_version"].as_uint64());
+
+   // text hashed submissions are accepted and the period rolls over on them
+   dayCycle("./tests/usage_data/usage_data_50.json", period_start_sec, dataset_batch_size, 0);
+   period_start_sec += period_seconds;
+   skipAhead(period_start_sec);
+   BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducerb)));
+   BOOST_REQUIRE_EQUAL(10, sources_table_info(N(defproducerb))["submissions_score"].as_uint64());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_legacy_distributions, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   time_point_sec period_start = time_point_sec(period_start_sec);
+   uint16_t dataset_batch_size = 5;
+
+   // eosio.system issued this period's inflation and paid out its first two datasets before eosio.oracle took over
+   set_legacy_resource_config(period_start, true, {1, 2});
+   produce_block();
+   initresource(dataset_batch_size, 1, period_start, 60 * 60 * 24, 0.1, 0.2947);
+   BOOST_REQUIRE_EQUAL(success(), resactivate(true));
+   produce_blocks(2);
+   BOOST_REQUIRE(resource_conf_info()["inflation_transferred"].as_bool());
+   BOOST_REQUIRE(!distribution_info(1).is_null());
+   BOOST_REQUIRE(!distribution_info(2).is_null());
+   BOOST_REQUIRE(distribution_info(3).is_null());
+
+   // the oracle resubmits the whole period, only the datasets eosio.system did not pay are queued
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_75.json");
+   struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, dataset_batch_size, 1, 0);
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducera), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+   vector<vector<fc::variant>> resubmitted(usage_data.usage_datasets.begin(), usage_data.usage_datasets.begin() + 3);
+   BOOST_REQUIRE_EQUAL(success(), addactusgm(N(defproducera), 1, resubmitted, period_start));
+   BOOST_REQUIRE_EQUAL(0, distribution_info(1)["row_count"].as_uint64());
+   BOOST_REQUIRE_EQUAL(0, distribution_info(2)["row_count"].as_uint64());
+   BOOST_REQUIRE_EQUAL(dataset_batch_size, distribution_info(3)["row_count"].as_uint64());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("dataset already distributed"), distribute(N(alice1111111), 1));
+   BOOST_REQUIRE_EQUAL(success(), distribute(N(alice1111111), 3));
+   BOOST_REQUIRE(get_account_pay(name(usage_data.usage_datasets[0][0]["a"].as_string())).is_null());
+   BOOST_REQUIRE(get_account_pay(name(usage_data.usage_datasets[1][0]["a"].as_string())).is_null());
+   BOOST_REQUIRE(!get_account_pay(name(usage_data.usage_datasets[2][0]["a"].as_string())).is_null());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_legacy_migration, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   time_point_sec period_start = time_point_sec(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   time_point_sec paid = period_start - 2 * 60 * 60 * 24;
+   name scope = name(uint64_t(period_start.sec_since_epoch()));
+
+   // unclaimed balances, an oracle score, settings and period rows eosio.system held before eosio.oracle
+   set_legacy_resource_config(period_start, false, {}, 5);
+   map<name, asset> balances = {{N(bp1), asset(10000, symbol{UX_CORE_SYM})}, {N(bp2), asset(20000, symbol{UX_CORE_SYM})}, {N(bp3), asset(30000, symbol{UX_CORE_SYM})}};
+   for (const auto &b : balances)
+      set_legacy_account_pay(b.first, b.second, paid);
+   set_legacy_source(N(defproducera), 7, 9);
+   set_legacy_period_row(config::system_account_name, N(ressysusage), N(defproducera).to_uint64_t(), "legacy_system_usage", mvo()("source", N(defproducera)));
+   set_legacy_period_row(scope, N(resusagedata), 1, "legacy_datasets", mvo()("id", 1)("hash", fc::sha256()));
+   set_legacy_period_row(scope, N(resconsensus), 0, "legacy_consensus", mvo()("id", 0)("dataset_id", 1)("hash", fc::sha256()));
+   set_legacy_period_row(scope, N(resdistrib), 1, "legacy_dataset_distribution", mvo()("dataset_id", 1));
+   set_legacy_period_row(config::system_account_name, N(resclaims), 0, "legacy_claim_root", mvo()("id", 0)("period_start", period_start)("dataset_id", 1));
+   produce_block();
+
+   initresource(5, 1, period_start, 60 * 60 * 24, 0.1, 0.2947);
+   BOOST_REQUIRE_EQUAL(5, inflation_conf_info()["emadraglimit"].as_uint64());
+
+   // balances move first, max_rows at a time
+   BOOST_REQUIRE_EQUAL(success(), migrateres(2));
+   BOOST_REQUIRE(!get_account_pay(N(bp2)).is_null());
+   BOOST_REQUIRE(get_account_pay(N(bp3)).is_null());
+   BOOST_REQUIRE(sources_table_info(N(defproducera)).is_null());
+
+   // then the scores, and the period tables within what is left of max_rows, the old resourceconf staying until they are empty
+   BOOST_REQUIRE_EQUAL(success(), migrateres(4));
+   BOOST_REQUIRE_EQUAL(0, table_row_count(config::system_account_name, N(ressysusage), config::system_account_name));
+   BOOST_REQUIRE_EQUAL(0, table_row_count(scope, N(resusagedata), config::system_account_name));
+   BOOST_REQUIRE_EQUAL(1, table_row_count(scope, N(resconsensus), config::system_account_name));
+   BOOST_REQUIRE_EQUAL(1, table_row_count(config::system_account_name, N(resourceconf), config::system_account_name));
+   BOOST_REQUIRE_EQUAL(success(), migrateres(10));
+   for (auto table : {N(resconsensus), N(resdistrib)})
+      BOOST_REQUIRE_EQUAL(0, table_row_count(scope, table, config::system_account_name));
+   BOOST_REQUIRE_EQUAL(0, table_row_count(config::system_account_name, N(resclaims), config::system_account_name));
+   BOOST_REQUIRE_EQUAL(0, table_row_count(config::system_account_name, N(resourceconf), config::system_account_name));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no legacy resource rows left"), migrateres(10));
+
+   for (const auto &b : balances)
+   {
+      auto pay = get_account_pay(b.first);
+      BOOST_REQUIRE_EQUAL(b.second, pay["balance"].as<asset>());
+      BOOST_REQUIRE_EQUAL(paid, pay["timestamp"].as<time_point_sec>());
+   }
+   BOOST_REQUIRE_EQUAL(7, sources_table_info(N(defproducera))["submissions_score"].as_uint64());
+   BOOST_REQUIRE_EQUAL(9, sources_table_info(N(defproducera))["submissions_count"].as_uint64());
+
+   // the imported balances are indexed by their last payout, so expired ones can be swept
+   BOOST_REQUIRE_EQUAL(success(), setclaimexp(60 * 60 * 24, N(eosio.upay)));
+   BOOST_REQUIRE_EQUAL(success(), sweepclaims(N(alice1111111), 10));
+   for (const auto &b : balances)
+      BOOST_REQUIRE(get_account_pay(b.first).is_null());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_bounded_rollover, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   // jump to UX start date
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+
+   // activate chain and vote for producers
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   time_point_sec period_start = time_point_sec(period_start_sec);
+
+   uint16_t dataset_batch_size = 50;
+   uint16_t oracle_consensus_threshold = 1;
+   uint32_t period_seconds = 60 * 60 * 24;
+   float initial_value_transfer_rate = 0.1;
+   float max_pay_constant = 0.2947;
+
+   initresource(dataset_batch_size, oracle_consensus_threshold, period_start, period_seconds, initial_value_transfer_rate, max_pay_constant);
+   resactivate(true);
+   produce_blocks(2);
+
+   // tens of thousands of generated rows, each dataset leaves a body, a consensus row and a distribution row behind
+   uint32_t rows = 30000;
+   BOOST_REQUIRE_EQUAL(success(), buyram(N(eosio), N(defproducera), ram_core_sym::from_string("1000.0000")));
+   ux_usage_data::usage_generator generator(4, rows);
+   usage_commitment commitment = stream_all_data_hash(generator, dataset_batch_size);
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducera), commitment.total_cpu_usage_us, commitment.total_net_usage_words, commitment.all_data_hash, period_start));
+   stream_usage_batches(generator, dataset_batch_size, [&](uint16_t dataset_id, const vector<fc::variant> &dataset) {
+      BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducera), dataset_id, dataset, period_start));
+      if (dataset_id % 50 == 0)
+         produce_block();
+   });
+   produce_blocks(2);
+
+   skipAhead(getSecondsSinceEpochUTC("2020-10-02 00:00:00"));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("max_rows must be greater than 0"), nextperiod(N(defproducera), 0));
+
+   // each call erases at most max_rows rows, counted from the tables' row counts
+   name scope = period_scope(period_start);
+   auto work_left = [&]() {
+      uint64_t left = 0;
+      for (auto table : {N(resusagedata), N(resconsensus), N(resdistrib), N(ressysusage)})
+         left += table_row_count(scope, table);
+      return left;
+   };
+   uint32_t datasets = commitment.datasets;
+   BOOST_REQUIRE_EQUAL(datasets + (datasets + 1) + datasets + 1, work_left());
+
+   uint16_t max_rows = 500;
+   uint32_t max_calls = work_left() / max_rows + 2;
+   uint32_t calls = 0;
+   bool cleared = false;
+   while (resource_conf_info()["period_start"].as<time_point_sec>() == period_start)
+   {
+      BOOST_REQUIRE_LT(calls++, max_calls);
+      uint64_t before = work_left();
+      BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducera), max_rows));
+      produce_block();
+      BOOST_REQUIRE_LE(before - work_left(), max_rows);
+      BOOST_REQUIRE_GT(before, work_left());
+
+      // submissions stay closed while the previous period is being cleared
+      if (resource_conf_info()["rollover_stage"].as_uint64() == 1)
+      {
+         cleared = true;
+         BOOST_REQUIRE_EQUAL(wasm_assert_msg("period rollover in progress"),
+                             settotalusg(N(defproducerb), commitment.total_cpu_usage_us, commitment.total_net_usage_words, commitment.all_data_hash, period_start));
+      }
+   }
+   BOOST_REQUIRE(cleared);
+   BOOST_REQUIRE_EQUAL(0, work_left());
+
+   BOOST_REQUIRE_EQUAL(0, resource_conf_info()["rollover_stage"].as_uint64());
+   BOOST_REQUIRE_EQUAL(time_point_sec(period_start_sec + period_seconds), resource_conf_info()["period_start"].as<time_point_sec>());
+   BOOST_REQUIRE(system_usage_table_info(N(defproducera)).is_null());
+   BOOST_REQUIRE_EQUAL(10, sources_table_info(N(defproducera))["submissions_score"].as_uint64());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_consensus_votes, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   time_point_sec period_start = time_point_sec(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   uint16_t dataset_batch_size = 5;
+   initresource(dataset_batch_size, 2, period_start, 60 * 60 * 24, 0.1, 0.2947);
+   resactivate(true);
+   produce_blocks(2);
+
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_50.json");
+   struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, dataset_batch_size);
+   auto &datasets = usage_data.usage_datasets;
+   for (auto oracle : {N(defproducera), N(defproducerb), N(defproducerc), N(defproducerd), N(defproducere)})
+      BOOST_REQUIRE_EQUAL(success(),
+                          settotalusg(oracle, usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+
+   auto votes = [&](uint16_t dataset_id) {
+      fc::variants rows;
+      for (const auto &row : period_rows(N(resconsensus), "consensus"))
+         if (row["dataset_id"].as_uint64() == dataset_id)
+            rows.push_back(row);
+      return rows;
+   };
+   auto distributed = [&](uint16_t dataset_id) { return !distribution_info(dataset_id).is_null(); };
+   auto hash_of = [](const vector<fc::variant> &dataset) {
+      vector<std::pair<account_name, uint64_t>> metrics;
+      for (const auto &row : dataset)
+         metrics.emplace_back(account_name(row["a"].as_string()), row["u"].as_uint64());
+      return hash_metrics(metrics).str();
+   };
+
+   // split votes stay below the threshold, the vote which brings one hash to it distributes that hash
+   vector<fc::variant> other = datasets[0];
+   other[0] = mvo()("a", other[0]["a"].as_string())("u", "1");
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducera), 1, datasets[0], period_start));
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerb), 1, other, period_start));
+   BOOST_REQUIRE_EQUAL(2, votes(1).size());
+   BOOST_REQUIRE(!distributed(1));
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerc), 1, datasets[0], period_start));
+   BOOST_REQUIRE(distributed(1));
+   BOOST_REQUIRE_EQUAL(2, votes(1).size());
+   for (const auto &row : votes(1))
+      BOOST_REQUIRE_EQUAL(row["hash"].as_string() == hash_of(datasets[0]) ? 2 : 1, row["count"].as_uint64());
+
+   // a vote row for another hash with the same low 64 bits, the secondary key, sorts first and must not take the vote
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducera), 2, datasets[1], period_start));
+   auto row = votes(2).at(0);
+   fc::sha256 collision = row["hash"].as<fc::sha256>();
+   collision._hash[3] ^= 1;
+   set_table_row(N(eosio.oracle), period_scope(period_start), N(resconsensus), row["id"].as_uint64(),
+                 oracle_abi_ser.variant_to_binary("consensus", mvo(row.get_object())("hash", collision), abi_serializer_max_time));
+   produce_block();
+
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerb), 2, datasets[1], period_start));
+   BOOST_REQUIRE_EQUAL(2, votes(2).size());
+   BOOST_REQUIRE(!distributed(2));
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerc), 2, datasets[1], period_start));
+   BOOST_REQUIRE(distributed(2));
+   BOOST_REQUIRE_EQUAL(2, votes(2).size());
+   BOOST_REQUIRE_EQUAL(collision.str(), votes(2)[0]["hash"].as_string());
+   BOOST_REQUIRE_EQUAL(1, votes(2)[0]["count"].as_uint64());
+   BOOST_REQUIRE_EQUAL(hash_of(datasets[1]), votes(2)[1]["hash"].as_string());
+   BOOST_REQUIRE_EQUAL(2, votes(2)[1]["count"].as_uint64());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_oracle_set, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+
+   // the cache is written with the first proposed schedule
+   vector<name> producers = active_and_vote_producers();
+   produce_blocks(2);
+
+   auto oracles = oracle_set_info()["oracles"].as<vector<name>>();
+   BOOST_REQUIRE_EQUAL(21, oracles.size());
+   BOOST_REQUIRE(std::is_sorted(oracles.begin(), oracles.end()));
+   BOOST_REQUIRE(oracles == producers);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   time_point_sec period_start = time_point_sec(period_start_sec);
+   initresource(5, 1, period_start, 60 * 60 * 24, 0.1, 0.2947);
+   resactivate(true);
+   produce_blocks(2);
+
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_80.json");
+   struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, 5);
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("not a qualified oracle"),
+                       settotalusg(N(alice1111111), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+
+   // move the votes from defproducera to a new producer so the next schedule replaces it
+   setup_producer_accounts({N(defproducerv)});
+   BOOST_REQUIRE_EQUAL(success(), regproducer(N(defproducerv)));
+   vector<name> voted(producers.begin() + 1, producers.end());
+   voted.push_back(N(defproducerv));
+   BOOST_REQUIRE_EQUAL(success(), vote(N(alice1111111), voted));
+   produce_blocks(250);
+
+   oracles = oracle_set_info()["oracles"].as<vector<name>>();
+   BOOST_REQUIRE(oracles == voted);
+
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("not a qualified oracle"),
+                       settotalusg(N(defproducera), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducerv), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_moving_average, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   initresource(5, 1, time_point_sec(period_start_sec), 60 * 60 * 24, 0.1, 0.2947);
+   resactivate(true);
+   produce_blocks(2);
+
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("emadraglimit must be between 1 and 255"), setdraglimit(0));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("emadraglimit must be between 1 and 255"), setdraglimit(256));
+
+   // each period's moving average must match the history rows it summarises
+   auto check_ma = [&](uint32_t day, uint32_t draglimit) {
+      auto current = get_resource_history(day);
+      uint32_t period = day - 1 < draglimit ? day : draglimit;
+      double cpu_total = current["use_cpu"].as_double();
+      double net_total = current["use_net"].as_double();
+      for (uint32_t i = 1; i < draglimit && i <= day; i++)
+      {
+         cpu_total += get_resource_history(day - i)["use_cpu"].as_double();
+         net_total += get_resource_history(day - i)["use_net"].as_double();
+      }
+      BOOST_REQUIRE_CLOSE(cpu_total / period, current["ma_cpu"].as_double(), 0.0001);
+      BOOST_REQUIRE_CLOSE(net_total / period, current["ma_net"].as_double(), 0.0001);
+   };
+
+   const vector<string> fixtures = {"./tests/usage_data/usage_data_10.json", "./tests/usage_data/usage_data_50.json", "./tests/usage_data/usage_data_80.json"};
+   uint32_t day = 0;
+   auto run_days = [&](uint32_t days, uint32_t draglimit) {
+      for (uint32_t i = 0; i < days; i++)
+      {
+         dayCycle(fixtures[day % fixtures.size()], period_start_sec, 5);
+         period_start_sec += 86400;
+         skipAhead(period_start_sec);
+         day++;
+         BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducerb)));
+         check_ma(day, draglimit);
+      }
+   };
+
+   BOOST_REQUIRE_EQUAL(success(), setdraglimit(5));
+   run_days(12, 5);
+   BOOST_REQUIRE_EQUAL(5, inflation_conf_info()["emadraglimit"].as_uint64());
+
+   // shrinking the window rebuilds it from the newest history rows
+   BOOST_REQUIRE_EQUAL(success(), setdraglimit(3));
+   run_days(5, 3);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_simulator, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   initresource(5, 1, time_point_sec(period_start_sec), 60 * 60 * 24, 0.1, 0.2947);
+   resactivate(true);
+   BOOST_REQUIRE_EQUAL(success(), setdraglimit(3));
+   produce_blocks(2);
+
+   auto gstate = get_global_state();
+   ux::simulator::config cfg;
+   cfg.max_block_cpu_usage = gstate["max_block_cpu_usage"].as_uint64();
+   cfg.max_block_net_usage = gstate["max_block_net_usage"].as_uint64();
+   cfg.initial_value_transfer_rate = 0.1;
+   cfg.max_pay_constant = 0.2947;
+   cfg.emadraglimit = 3;
+   cfg.supply = get_token_supply().get_amount();
+   cfg.max_supply = get_stats("4," UX_CORE_SYM_NAME)["max_supply"].as<asset>().get_amount();
+
+   // replay the same totals on chain and in the simulator
+   const vector<string> fixtures = {"./tests/usage_data/usage_data_10.json", "./tests/usage_data/usage_data_80.json",
+                                    "./tests/usage_data/usage_data_50.json", "./tests/usage_data/usage_data_cpu_80_net_40.json"};
+   vector<ux::simulator::usage_sample> path;
+   for (uint32_t day = 0; day < 40; day++)
+   {
+      const string &fixture = fixtures[day * 7 % fixtures.size()];
+      struct oracle_data usage_data = generate_all_data_hash(json_from_file_or_string(fixture), 5);
+      path.push_back({usage_data.total_cpu_usage_us, usage_data.total_net_usage_words});
+
+      dayCycle(fixture, period_start_sec, 5);
+      period_start_sec += 86400;
+      skipAhead(period_start_sec);
+      BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducerb)));
+   }
+
+   ux::simulator::result simulated = ux::simulator::simulate(cfg, path);
+   BOOST_REQUIRE(simulated.error.empty());
+   BOOST_REQUIRE_EQUAL(path.size(), simulated.rows.size());
+
+   // both sides run the same fixed point model, so every value is expected to be bit identical
+   for (const auto &row : simulated.rows)
+   {
+      auto history = get_resource_history(row.daycount);
+      BOOST_REQUIRE_EQUAL(row.daycount, history["daycount"].as_uint64());
+      BOOST_REQUIRE_EQUAL(row.use_cpu, history["use_cpu"].as_double());
+      BOOST_REQUIRE_EQUAL(row.use_net, history["use_net"].as_double());
+      BOOST_REQUIRE_EQUAL(row.ma_cpu, history["ma_cpu"].as_double());
+      BOOST_REQUIRE_EQUAL(row.ema_cpu, history["ema_cpu"].as_double());
+      BOOST_REQUIRE_EQUAL(row.ema_util_total, history["ema_util_total"].as_double());
+      BOOST_REQUIRE_EQUAL(row.inflation, history["inflation"].as_double());
+      BOOST_REQUIRE_EQUAL(row.inflation_daily, history["inflation_daily"].as_double());
+      BOOST_REQUIRE_EQUAL(row.utility_daily, history["utility_daily"].as_double());
+      BOOST_REQUIRE_EQUAL(row.bppay_daily, history["bppay_daily"].as_double());
+      BOOST_REQUIRE_EQUAL(row.utility_tokens, history["utility_tokens"].as<asset>().get_amount());
+      BOOST_REQUIRE_EQUAL(row.bppay_tokens, history["bppay_tokens"].as<asset>().get_amount());
+   }
+   BOOST_REQUIRE_EQUAL(simulated.rows.back().supply, get_token_supply().get_amount());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_compressed_usage, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   time_point_sec period_start = time_point_sec(period_start_sec);
+   uint16_t dataset_batch_size = 5;
+   initresource(dataset_batch_size, 2, period_start, 60 * 60 * 24, 0.1, 0.2947);
+   resactivate(true);
+   produce_blocks(2);
+
+   // fixture accounts are already in ascending name order
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_50.json");
+   struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, dataset_batch_size);
+
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducera), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducerb), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+
+   vector<char> payload = encode_usage(usage_data.usage_datasets[0]);
+   vector<std::pair<account_name, uint64_t>> plain;
+   for (const auto &row : usage_data.usage_datasets[0])
+      plain.emplace_back(account_name(row["a"].as_string()), row["u"].as_uint64());
+   BOOST_REQUIRE_LT(payload.size(), fc::raw::pack(plain).size());
+
+   // malformed payloads are rejected before any state changes
+   vector<char> truncated(payload.begin(), payload.end() - 1);
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("truncated usage payload"), addactusgz(N(defproducerb), 1, truncated, period_start));
+   vector<char> trailing = payload;
+   trailing.push_back(0);
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("unexpected data after usage payload"), addactusgz(N(defproducerb), 1, trailing, period_start));
+   vector<fc::variant> unsorted = {usage_data.usage_datasets[0][1], usage_data.usage_datasets[0][0]};
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("usage payload accounts must be strictly ascending"), addactusgz(N(defproducerb), 1, encode_usage(unsorted), period_start));
+
+   // a plain and a compressed submission of the same dataset count towards the same consensus
+   for (int i = 0; i < usage_data.usage_datasets.size(); i++)
+   {
+      BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducera), i + 1, usage_data.usage_datasets[i], period_start));
+      if (i == 0)
+         BOOST_REQUIRE(get_account_pay(N(bp1)).is_null());
+      BOOST_REQUIRE_EQUAL(success(), addactusgz(N(defproducerb), i + 1, encode_usage(usage_data.usage_datasets[i]), period_start));
+   }
+   BOOST_REQUIRE(get_account_pay(N(bp1)).is_null());
+   distribute_datasets(usage_data.usage_datasets.size());
+   BOOST_REQUIRE(!get_account_pay(N(bp1)).is_null());
+   BOOST_REQUIRE(!get_account_pay(N(bpe)).is_null());
+   BOOST_REQUIRE_EQUAL(fc::json::to_string(system_usage_table_info(N(defproducera))["merkle_peaks"]),
+                       fc::json::to_string(system_usage_table_info(N(defproducerb))["merkle_peaks"]));
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_multi_dataset, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   time_point_sec period_start = time_point_sec(period_start_sec);
+   uint16_t dataset_batch_size = 2;
+   initresource(dataset_batch_size, 2, period_start, 60 * 60 * 24, 0.1, 0.2947);
+   resactivate(true);
+   produce_blocks(2);
+
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_75.json");
+   struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, dataset_batch_size);
+   BOOST_REQUIRE_EQUAL(5, usage_data.usage_datasets.size());
+
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducera), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducerb), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("must supply at least one dataset"), addactusgm(N(defproducera), 1, {}, period_start));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("dataset_id differs from expected value"), addactusgm(N(defproducera), 2, usage_data.usage_datasets, period_start));
+
+   // each batch is still bounded by dataset_batch_size
+   vector<vector<fc::variant>> oversized = {usage_data.usage_datasets[0], usage_data.usage_datasets[1]};
+   oversized[1].push_back(usage_data.usage_datasets[2][0]);
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("must supply fewer dataset values"), addactusgm(N(defproducera), 1, oversized, period_start));
+
+   // one oracle submits every dataset in a single action, the other one by one
+   BOOST_REQUIRE_EQUAL(success(), addactusgm(N(defproducera), 1, usage_data.usage_datasets, period_start));
+   BOOST_REQUIRE_EQUAL(usage_data.usage_datasets.size() + 1, system_usage_table_info(N(defproducera))["submission_count"].as_uint64());
+   BOOST_REQUIRE(get_account_pay(N(bp1)).is_null());
+   BOOST_REQUIRE(distribution_info(1).is_null());
+   for (int i = 0; i < usage_data.usage_datasets.size(); i++)
+   {
+      BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerb), i + 1, usage_data.usage_datasets[i], period_start));
+      BOOST_REQUIRE(!distribution_info(i + 1).is_null());
+   }
+   distribute_datasets(usage_data.usage_datasets.size());
+   BOOST_REQUIRE(!get_account_pay(N(bp1)).is_null());
+   BOOST_REQUIRE(!get_account_pay(N(bpe)).is_null());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("cannot change hash version while submissions are open"), sethashver(0));
+   auto batched = system_usage_table_info(N(defproducera));
+   auto single = system_usage_table_info(N(defproducerb));
+   BOOST_REQUIRE_EQUAL(batched["allocated_cpu"].as_uint64(), single["allocated_cpu"].as_uint64());
+   BOOST_REQUIRE_EQUAL(fc::json::to_string(batched["merkle_peaks"]), fc::json::to_string(single["merkle_peaks"]));
+
+   skipAhead(getSecondsSinceEpochUTC("2020-10-02 00:00:00"));
+   BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducera)));
+   BOOST_REQUIRE_EQUAL(10, sources_table_info(N(defproducera))["submissions_score"].as_uint64());
+   BOOST_REQUIRE(distribution_info(1).is_null());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_claim_many, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   time_point_sec period_start = time_point_sec(period_start_sec);
+   initresource(5, 1, period_start, 60 * 60 * 24, 0.1, 0.2947);
+   resactivate(true);
+   produce_blocks(2);
+
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_75.json");
+   struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, 5);
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducera), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+   BOOST_REQUIRE_EQUAL(success(), addactusgm(N(defproducera), 1, usage_data.usage_datasets, period_start));
+   distribute_datasets(usage_data.usage_datasets.size());
+
+   const vector<name> accounts = {N(bp1), N(bp2), N(bp3), N(bp4), N(bp5)};
+   for (const auto &account : accounts)
+      delegate_claim(account, N(alice1111111));
+
+   map<name, asset> expected;
+   for (const auto &account : accounts)
+      expected[account] = get_balance(account) + get_account_pay(account)["balance"].as<asset>();
+
+   // the relayer only holds the linked claim permission, not the accounts' active permission
+   BOOST_REQUIRE(claimmany(N(alice1111111), {N(bp1)}, config::active_name) != success());
+   BOOST_REQUIRE(claimmany(N(alice1111111), {N(bp1), N(bpa)}) != success());
+
+   // repeated accounts are paid once
+   vector<name> listed = accounts;
+   listed.push_back(N(bp3));
+   listed.push_back(N(bp1));
+   BOOST_REQUIRE_EQUAL(success(), claimmany(N(alice1111111), listed));
+   for (const auto &account : accounts)
+   {
+      BOOST_REQUIRE_EQUAL(expected[account], get_balance(account));
+      BOOST_REQUIRE(get_account_pay(account).is_null());
+   }
+   BOOST_REQUIRE(!get_account_pay(N(bpa)).is_null());
+
+   // accounts without a balance are skipped but still have to authorise
+   delegate_claim(N(bpa), N(alice1111111));
+   asset bpa_expected = get_balance(N(bpa)) + get_account_pay(N(bpa))["balance"].as<asset>();
+   BOOST_REQUIRE_EQUAL(success(), claimmany(N(alice1111111), {N(bp1), N(bpa), N(bp2)}));
+   BOOST_REQUIRE_EQUAL(bpa_expected, get_balance(N(bpa)));
+   BOOST_REQUIRE(get_account_pay(N(bpa)).is_null());
+   BOOST_REQUIRE_EQUAL(expected[N(bp1)], get_balance(N(bp1)));
+   BOOST_REQUIRE_EQUAL(success(), claimmany(N(alice1111111), {N(bp1)}));
+   BOOST_REQUIRE_EQUAL(expected[N(bp1)], get_balance(N(bp1)));
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_aggregator, ux_system_tester)
+try
+{
+   using namespace std;
+   const vector<string> fixtures = {"./tests/usage_data/usage_data_75.json", "./tests/usage_data/usage_data_cpu_80_net_40.json",
+                                    "./tests/usage_data/usage_data_rand.json"};
+   for (const auto &fixture : fixtures)
+   {
+      for (uint8_t hash_version : {0, 1})
+      {
+         for (uint32_t batch_size : {1, 3, 500})
+         {
+            struct oracle_data expected = generate_all_data_hash(json_from_file_or_string(fixture), batch_size, 1, hash_version);
+
+            ux::aggregator::options opts;
+            opts.batch_size = batch_size;
+            opts.hash_version = hash_version;
+            std::ifstream in(fixture);
+            uint32_t datasets = 0;
+            auto res = ux::aggregator::aggregate(in, opts, [&](uint32_t id, const vector<ux::aggregator::usage_row> &dataset, const ux::aggregator::digest &) {
+               BOOST_REQUIRE_EQUAL(++datasets, id);
+               BOOST_REQUIRE_EQUAL(expected.usage_datasets[id - 1].size(), dataset.size());
+               for (size_t i = 0; i < dataset.size(); i++)
+               {
+                  BOOST_REQUIRE_EQUAL(expected.usage_datasets[id - 1][i]["a"].as_string(), ux::aggregator::name_to_string(dataset[i].account));
+                  BOOST_REQUIRE_EQUAL(expected.usage_datasets[id - 1][i]["u"].as_uint64(), dataset[i].cpu_us);
+               }
+            });
+            BOOST_REQUIRE_EQUAL(expected.usage_datasets.size(), res.datasets);
+            BOOST_REQUIRE_EQUAL(expected.total_cpu_usage_us, res.total_cpu_us);
+            BOOST_REQUIRE_EQUAL(expected.total_net_usage_words, res.total_net_words);
+            BOOST_REQUIRE_EQUAL(expected.all_data_hash, ux::aggregator::to_hex(res.all_data_hash));
+         }
+      }
+   }
+
+   // unordered line delimited rows with split accounts fold to the same batches, also when chunks spill to disk
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_75.json");
+   struct oracle_data expected = generate_all_data_hash(usage_data_vo, 4);
+   std::stringstream lines;
+   const auto &rows = usage_data_vo.get_array();
+   for (size_t i = rows.size(); i-- > 0;)
+   {
+      uint64_t u = rows[i]["u"].as_uint64();
+      uint64_t net = rows[i]["net"].as_uint64();
+      lines << "{\"a\":\"" << rows[i]["a"].as_string() << "\",\"u\":" << u / 3 << ",\"net\":" << net / 3 << "}\n";
+      lines << "{\"net\":\"" << net - net / 3 << "\",\"u\":\"" << u - u / 3 << "\",\"a\":\"" << rows[i]["a"].as_string() << "\"}\n";
+   }
+   for (size_t chunk_rows : {size_t(3), size_t(1) << 22})
+   {
+      ux::aggregator::options opts;
+      opts.batch_size = 4;
+      opts.chunk_rows = chunk_rows;
+      opts.threads = 2;
+      std::stringstream in(lines.str());
+      auto res = ux::aggregator::aggregate(in, opts);
+      BOOST_REQUIRE_EQUAL(2 * rows.size(), res.rows);
+      BOOST_REQUIRE_EQUAL(rows.size(), res.accounts);
+      BOOST_REQUIRE_EQUAL(expected.all_data_hash, ux::aggregator::to_hex(res.all_data_hash));
+   }
+
+   std::stringstream bad("[{\"a\":\"bp1\",\"u\":-1}]");
+   BOOST_REQUIRE_THROW(ux::aggregator::aggregate(bad, ux::aggregator::options()), std::runtime_error);
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_claim_proof, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   time_point_sec period_start = time_point_sec(period_start_sec);
+   uint16_t dataset_batch_size = 4;
+   initresource(dataset_batch_size, 2, period_start, 60 * 60 * 24, 0.1, 0.2947);
+   resactivate(true);
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("unsupported distribution mode"), setdistmode(2));
+   BOOST_REQUIRE_EQUAL(success(), setdistmode(1));
+   produce_blocks(2);
+
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_75.json");
+   struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, dataset_batch_size);
+
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducera), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("cannot change distribution mode while submissions are open"), setdistmode(0));
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducerb), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducera), 1, usage_data.usage_datasets[0], period_start));
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerb), 1, usage_data.usage_datasets[0], period_start));
+
+   // consensus writes one root for the dataset instead of a balance per account
+   BOOST_REQUIRE(get_account_pay(N(bp1)).is_null());
+   auto root_row = claim_root_info(0);
+   BOOST_REQUIRE(!root_row.is_null());
+   BOOST_REQUIRE_EQUAL(1, root_row["dataset_id"].as_uint64());
+   BOOST_REQUIRE_EQUAL(usage_data.usage_datasets[0].size(), root_row["leaf_count"].as_uint64());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("dataset already distributed"), distribute(N(alice1111111), 1));
+
+   int64_t utility_tokens = get_resource_history(1)["utility_tokens"].as<asset>().get_amount();
+   vector<fc::sha256> leaves;
+   vector<asset> amounts;
+   for (uint32_t i = 0; i < usage_data.usage_datasets[0].size(); i++)
+   {
+      const auto &m = usage_data.usage_datasets[0][i];
+      int64_t amount = static_cast<int64_t>(static_cast<unsigned __int128>(m["u"].as_uint64()) * utility_tokens / usage_data.total_cpu_usage_us);
+      amounts.push_back(asset(amount, symbol{UX_CORE_SYM}));
+      leaves.push_back(claim_leaf_hash(i, account_name(m["a"].as_string()), amount));
+   }
+   BOOST_REQUIRE_EQUAL(merkle_root(leaves, 0, leaves.size()).str(), root_row["root"].as_string());
+
+   // the root outlives the period rollover
+   skipAhead(getSecondsSinceEpochUTC("2020-10-02 00:00:00"));
+   BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducera)));
+
+   uint32_t index = 2;
+   name account = name(usage_data.usage_datasets[0][index]["a"].as_string());
+   auto proof = merkle_proof(leaves, index, 0, leaves.size());
+   auto balance = get_balance(account);
+
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("invalid claim proof"), claimproof(account, period_start, 1, index, amounts[index] + asset(1, symbol{UX_CORE_SYM}), proof));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("invalid claim proof"), claimproof(account, period_start, 1, index + 1, amounts[index + 1], proof));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("leaf index out of range"), claimproof(account, period_start, 1, leaves.size(), amounts[index], proof));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("claim root not found"), claimproof(account, period_start, 2, index, amounts[index], proof));
+
+   BOOST_REQUIRE_EQUAL(success(), claimproof(account, period_start, 1, index, amounts[index], proof));
+   BOOST_REQUIRE_EQUAL(balance + amounts[index], get_balance(account));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("already claimed"), claimproof(account, period_start, 1, index, amounts[index], proof));
+
+   // every other leaf is still redeemable, the last one is left unclaimed
+   uint32_t unclaimed = leaves.size() - 1;
+   for (uint32_t i = 0; i < unclaimed; i++)
+   {
+      if (i == index)
+         continue;
+      name a = name(usage_data.usage_datasets[0][i]["a"].as_string());
+      BOOST_REQUIRE_EQUAL(success(), claimproof(a, period_start, 1, i, amounts[i], merkle_proof(leaves, i, 0, leaves.size())));
+   }
+   int64_t claimed = 0;
+   for (uint32_t i = 0; i < unclaimed; i++)
+      claimed += amounts[i].get_amount();
+   root_row = claim_root_info(0);
+   BOOST_REQUIRE_EQUAL(claimed + amounts[unclaimed].get_amount(), root_row["amount"].as_int64());
+   BOOST_REQUIRE_EQUAL(claimed, root_row["claimed_amount"].as_int64());
+
+   // once expired the root is swept with the unclaimed remainder
+   BOOST_REQUIRE_EQUAL(success(), setclaimexp(2 * 60 * 60 * 24, N(eosio.saving)));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no expired balances"), sweepclaims(N(carol1111111), 10));
+   skipAhead(getSecondsSinceEpochUTC("2020-10-03 00:00:00"));
+   auto saving = get_balance(N(eosio.saving));
+   BOOST_REQUIRE_EQUAL(success(), sweepclaims(N(carol1111111), 10));
+   BOOST_REQUIRE(claim_root_info(0).is_null());
+   BOOST_REQUIRE_EQUAL(saving + amounts[unclaimed], get_balance(N(eosio.saving)));
+   name last = name(usage_data.usage_datasets[0][unclaimed]["a"].as_string());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("claim root not found"),
+                       claimproof(last, period_start, 1, unclaimed, amounts[unclaimed], merkle_proof(leaves, unclaimed, 0, leaves.size())));
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_streamed_usage, ux_system_tester)
+try
+{
+   using namespace std;
+
+   // the streamed loader matches generate_all_data_hash on the fixtures
+   for (uint8_t hash_version : {0, 1})
+   {
+      ux_usage_data::usage_file file("./tests/usage_data/usage_data_75.json");
+      struct oracle_data expected = generate_all_data_hash(json_from_file_or_string("./tests/usage_data/usage_data_75.json"), 3, 1, hash_version);
+      usage_commitment streamed = stream_all_data_hash(file, 3, hash_version);
+      BOOST_REQUIRE_EQUAL(expected.all_data_hash, streamed.all_data_hash);
+      BOOST_REQUIRE_EQUAL(expected.total_cpu_usage_us, streamed.total_cpu_usage_us);
+      BOOST_REQUIRE_EQUAL(expected.total_net_usage_words, streamed.total_net_usage_words);
+      BOOST_REQUIRE_EQUAL(expected.usage_datasets.size(), streamed.datasets);
+      stream_usage_batches(file, 3, [&](uint16_t dataset_id, const vector<fc::variant> &dataset) {
+         BOOST_REQUIRE_EQUAL(fc::json::to_string(fc::variant(expected.usage_datasets[dataset_id - 1])), fc::json::to_string(fc::variant(dataset)));
+      });
+   }
+
+   // the generator is reproducible from its seed and heavy tailed
+   ux_usage_data::usage_generator a(7, 100000), b(7, 100000), c(8, 100000);
+   ux_usage_data::usage_row ra, rb, rc;
+   vector<uint64_t> cpu;
+   bool differs = false;
+   while (a.next(ra))
+   {
+      BOOST_REQUIRE(b.next(rb) && c.next(rc));
+      BOOST_REQUIRE_EQUAL(ra.account, rb.account);
+      BOOST_REQUIRE_EQUAL(ra.cpu_us, rb.cpu_us);
+      BOOST_REQUIRE_EQUAL(ra.net_words, rb.net_words);
+      BOOST_REQUIRE_GT(ra.cpu_us, 0);
+      differs |= ra.cpu_us != rc.cpu_us;
+      cpu.push_back(ra.cpu_us);
+   }
+   BOOST_REQUIRE(differs);
+   sort(cpu.rbegin(), cpu.rend());
+   uint64_t total = accumulate(cpu.begin(), cpu.end(), uint64_t(0));
+   uint64_t top = accumulate(cpu.begin(), cpu.begin() + cpu.size() / 100, uint64_t(0));
+   BOOST_REQUIRE_GT(top * 5, total); // the top 1% of accounts use more than 20% of the cpu
+
+   // a generated period is submitted batch by batch and accepted as the modal data
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   time_point_sec period_start = time_point_sec(period_start_sec);
+   initresource(100, 1, period_start, 60 * 60 * 24, 0.1, 0.2947);
+   resactivate(true);
+   produce_blocks(2);
+
+   ux_usage_data::usage_generator generator(42, 2000);
+   usage_commitment commitment = stream_all_data_hash(generator, 100);
+   BOOST_REQUIRE_EQUAL(20, commitment.datasets);
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducera), commitment.total_cpu_usage_us, commitment.total_net_usage_words, commitment.all_data_hash, period_start));
+   stream_usage_batches(generator, 100, [&](uint16_t dataset_id, const vector<fc::variant> &dataset) {
+      BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducera), dataset_id, dataset, period_start));
+   });
+
+   skipAhead(period_start_sec + 60 * 60 * 24);
+   BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducera)));
+   BOOST_REQUIRE_EQUAL(10, sources_table_info(N(defproducera))["submissions_score"].as_uint64());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_pipelined_periods, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   uint32_t period_seconds = 60 * 60 * 24;
+   time_point_sec period_start = time_point_sec(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   time_point_sec next_period_start = period_start + period_seconds;
+   uint16_t dataset_batch_size = 2;
+   initresource(dataset_batch_size, 2, period_start, period_seconds, 0.1, 0.2947);
+   resactivate(true);
+   produce_blocks(2);
+
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_75.json");
+   struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, dataset_batch_size);
+
+   auto submit = [&](time_point_sec period) {
+      for (auto oracle : {N(defproducera), N(defproducerb)})
+      {
+         BOOST_REQUIRE_EQUAL(success(),
+                             settotalusg(oracle, usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period));
+         BOOST_REQUIRE_EQUAL(success(), addactusgm(oracle, 1, usage_data.usage_datasets, period));
+      }
+      produce_block();
+   };
+
+   submit(period_start);
+   distribute_datasets(usage_data.usage_datasets.size());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("next period has not started"),
+                       settotalusg(N(defproducera), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, next_period_start));
+
+   // the next period fills up before nextperiod closes the current one, but nothing is paid out for it yet
+   skipAhead(getSecondsSinceEpochUTC("2020-10-02 00:00:00"));
+   auto upay = get_balance(N(eosio.upay)).get_amount();
+   auto bp1_pay = get_account_pay(N(bp1))["balance"].as<asset>().get_amount();
+   submit(next_period_start);
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("period_start does not match an open period"),
+                       settotalusg(N(defproducerc), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, next_period_start + period_seconds));
+   BOOST_REQUIRE_EQUAL(upay, get_balance(N(eosio.upay)).get_amount());
+   BOOST_REQUIRE_EQUAL(usage_data.usage_datasets.size() + 1, system_usage_table_info(N(defproducera), next_period_start)["submission_count"].as_uint64());
+   BOOST_REQUIRE(distribution_info(1, next_period_start).is_null());
+   BOOST_REQUIRE(!distribution_info(1).is_null());
+
+   // advancing has eosio.system issue the next period's inflation, its datasets are queued by the following call
+   BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducera)));
+   BOOST_REQUIRE_EQUAL(next_period_start, resource_conf_info()["period_start"].as<time_point_sec>());
+   BOOST_REQUIRE_EQUAL(2, resource_conf_info()["rollover_stage"].as_uint64());
+   BOOST_REQUIRE(resource_conf_info()["inflation_transferred"].as_bool());
+   BOOST_REQUIRE_LT(upay, get_balance(N(eosio.upay)).get_amount());
+   BOOST_REQUIRE_EQUAL(bp1_pay, get_account_pay(N(bp1))["balance"].as<asset>().get_amount());
+   produce_block();
+   BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducera)));
+   BOOST_REQUIRE_EQUAL(0, resource_conf_info()["rollover_stage"].as_uint64());
+   BOOST_REQUIRE_EQUAL(bp1_pay, get_account_pay(N(bp1))["balance"].as<asset>().get_amount());
+   for (int i = 0; i < usage_data.usage_datasets.size(); i++)
+      BOOST_REQUIRE_EQUAL(0, distribution_info(i + 1)["next_row"].as_uint64());
+   BOOST_REQUIRE(system_usage_table_info(N(defproducera), period_start).is_null());
+
+   // nobody calls distribute this period, with a small budget the rollover accrues the queued datasets first
+   // and the rollover and the catch up queueing are spread over several calls
+   time_point_sec third_period_start = next_period_start + period_seconds;
+   skipAhead(getSecondsSinceEpochUTC("2020-10-03 00:00:00"));
+   submit(third_period_start);
+   bool paying_out = false;
+   for (int call = 0; call < 50 && resource_conf_info()["period_start"].as<time_point_sec>() != third_period_start; call++)
+   {
+      BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducera), 4));
+      produce_block();
+   }
+   BOOST_REQUIRE_EQUAL(third_period_start, resource_conf_info()["period_start"].as<time_point_sec>());
+   BOOST_REQUIRE_LT(bp1_pay, get_account_pay(N(bp1))["balance"].as<asset>().get_amount());
+   for (int call = 0; call < 50 && resource_conf_info()["rollover_stage"].as_uint64() == 2; call++)
+   {
+      paying_out = true;
+      BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducera), 1));
+      produce_block();
+   }
+   BOOST_REQUIRE(paying_out);
+   BOOST_REQUIRE_EQUAL(0, resource_conf_info()["rollover_stage"].as_uint64());
+   for (int i = 0; i < usage_data.usage_datasets.size(); i++)
+      BOOST_REQUIRE(!distribution_info(i + 1).is_null());
+
+   // the period has not ended, so once the queueing is done nextperiod asks for it to end
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("current resource period has not ended"), nextperiod(N(defproducera)));
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_duplicate_accounts, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   time_point_sec period_start = time_point_sec(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   uint16_t dataset_batch_size = 1000;
+   initresource(dataset_batch_size, 2, period_start, 60 * 60 * 24, 0.1, 0.2947);
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("unsupported dedupe mode"), setdedupe(2));
+   BOOST_REQUIRE_EQUAL(success(), setdedupe(1));
+   resactivate(true);
+   produce_blocks(2);
+
+   // 100k accounts in name order, as an ordered submission lists them
+   vector<ux_usage_data::usage_row> rows;
+   ux_usage_data::usage_generator generator(5, 100000);
+   ux_usage_data::usage_row row;
+   uint64_t total_cpu = 0, total_net = 0;
+   while (generator.next(row))
+   {
+      rows.push_back(row);
+      total_cpu += row.cpu_us;
+      total_net += row.net_words;
+   }
+   sort(rows.begin(), rows.end(), [](const auto &l, const auto &r) { return l.account < r.account; });
+   auto to_dataset = [&](size_t begin, size_t end) {
+      vector<fc::variant> dataset;
+      for (size_t i = begin; i < end; i++)
+         dataset.push_back(mvo()("a", name(rows[i].account).to_string())("u", rows[i].cpu_us));
+      return dataset;
+   };
+
+   // two pairs of oracles agree on different batchings of the first six accounts, which issues the inflation
+   string no_commitment = fc::sha256().str();
+   for (auto oracle : {N(defproducerc), N(defproducerd), N(defproducere), N(defproducerf)})
+      BOOST_REQUIRE_EQUAL(success(), settotalusg(oracle, total_cpu, total_net, no_commitment, period_start));
+   BOOST_REQUIRE(resource_conf_info()["inflation_transferred"].as_bool());
+
+   // defproducere and defproducerf agree on a second dataset overlapping the first one paid out, only its uncovered account is paid
+   for (auto oracle : {N(defproducerc), N(defproducerd)})
+      BOOST_REQUIRE_EQUAL(success(), addactusg(oracle, 1, to_dataset(1, 4), period_start));
+   distribute_datasets(1);
+   BOOST_REQUIRE_EQUAL(name(rows[3].account), distribution_info(1)["last_account"].as<name>());
+   auto paid_once = get_account_pay(name(rows[2].account))["balance"].as<asset>();
+   for (auto oracle : {N(defproducere), N(defproducerf)})
+   {
+      BOOST_REQUIRE_EQUAL(success(), addactusg(oracle, 1, to_dataset(0, 1), period_start));
+      BOOST_REQUIRE_EQUAL(success(), addactusg(oracle, 2, to_dataset(2, 5), period_start));
+   }
+   BOOST_REQUIRE_EQUAL(1, distribution_info(2)["row_count"].as_uint64());
+   distribute_datasets(2);
+   BOOST_REQUIRE_EQUAL(name(rows[4].account), distribution_info(2)["first_account"].as<name>());
+   BOOST_REQUIRE_EQUAL(name(rows[4].account), distribution_info(2)["last_account"].as<name>());
+   BOOST_REQUIRE_EQUAL(paid_once, get_account_pay(name(rows[2].account))["balance"].as<asset>());
+   auto paid_uncovered = get_account_pay(name(rows[4].account))["balance"].as<asset>();
+   BOOST_REQUIRE(paid_uncovered.get_amount() > 0);
+
+   // the first pair's second dataset has an id already settled, nothing more is paid for it
+   for (auto oracle : {N(defproducerc), N(defproducerd)})
+      BOOST_REQUIRE_EQUAL(success(), addactusg(oracle, 2, to_dataset(4, 6), period_start));
+   BOOST_REQUIRE_EQUAL(name(rows[4].account), distribution_info(2)["first_account"].as<name>());
+   BOOST_REQUIRE_EQUAL(paid_uncovered, get_account_pay(name(rows[4].account))["balance"].as<asset>());
+   BOOST_REQUIRE(get_account_pay(name(rows[5].account)).is_null());
+
+   // an oracle submitting every account, duplicates within a batch and across batches are rejected
+   BOOST_REQUIRE_EQUAL(success(), buyrambytes(N(alice1111111), N(defproducera), 3 * 1024 * 1024));
+   BOOST_REQUIRE_EQUAL(success(), settotalusg(N(defproducera), total_cpu, total_net, no_commitment, period_start));
+   vector<fc::variant> repeated = to_dataset(0, 2);
+   repeated.push_back(repeated.back());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("duplicate or unordered account in usage data"), addactusg(N(defproducera), 1, repeated, period_start));
+   vector<fc::variant> unordered = to_dataset(0, 2);
+   swap(unordered[0], unordered[1]);
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("duplicate or unordered account in usage data"), addactusg(N(defproducera), 1, unordered, period_start));
+
+   uint16_t dataset_id = 1;
+   for (size_t begin = 0; begin < rows.size(); begin += dataset_batch_size)
+   {
+      size_t end = min(rows.size(), begin + dataset_batch_size);
+      if (begin > 0)
+      {
+         BOOST_REQUIRE_EQUAL(wasm_assert_msg("duplicate or unordered account in usage data"),
+                             addactusgz(N(defproducera), dataset_id, encode_usage(to_dataset(begin - 1, end - 1)), period_start));
+         BOOST_REQUIRE_EQUAL(wasm_assert_msg("duplicate or unordered account in usage data"),
+                             addactusg(N(defproducera), dataset_id, to_dataset(begin / 2, begin / 2 + 1), period_start));
+      }
+      BOOST_REQUIRE_EQUAL(success(), addactusgz(N(defproducera), dataset_id++, encode_usage(to_dataset(begin, end)), period_start));
+      if (dataset_id % 10 == 0)
+         produce_block();
+   }
+   auto totals = system_usage_table_info(N(defproducera));
+   BOOST_REQUIRE_EQUAL(rows.size() / dataset_batch_size + 1, totals["submission_count"].as_uint64());
+   BOOST_REQUIRE_EQUAL(total_cpu, totals["allocated_cpu"].as_uint64());
+   BOOST_REQUIRE_EQUAL(name(rows.back().account), totals["last_account"].as<name>());
+
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("cannot change dedupe mode while submissions are open"), setdedupe(0));
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_sweep_claims, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   time_point_sec period_start = time_point_sec(period_start_sec);
+   uint32_t period_seconds = 60 * 60 * 24;
+   uint16_t dataset_batch_size = 2;
+   initresource(dataset_batch_size, 2, period_start, period_seconds, 0.1, 0.2947);
+   resactivate(true);
+   produce_blocks(2);
+
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_75.json");
+   struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, dataset_batch_size);
+   for (auto oracle : {N(defproducera), N(defproducerb)})
+   {
+      BOOST_REQUIRE_EQUAL(success(),
+                          settotalusg(oracle, usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+      BOOST_REQUIRE_EQUAL(success(), addactusgm(oracle, 1, usage_data.usage_datasets, period_start));
+   }
+   distribute_datasets(usage_data.usage_datasets.size());
+
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("claim expiry not enabled"), sweepclaims(N(carol1111111), 10));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("sweep account does not exist"), setclaimexp(2 * period_seconds, N(nosuchacct)));
+   BOOST_REQUIRE_EQUAL(success(), setclaimexp(2 * period_seconds, N(carol1111111)));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no expired balances"), sweepclaims(N(bob111111111), 10));
+
+   // bp1 claims in time, every other balance is left to expire
+   BOOST_REQUIRE_EQUAL(success(), claimdistrib(N(bp1)));
+   set<name> unclaimed;
+   int64_t unclaimed_total = 0;
+   for (const auto &dataset : usage_data.usage_datasets)
+      for (const auto &row : dataset)
+      {
+         name account(row["a"].as_string());
+         auto pay = get_account_pay(account);
+         if (!pay.is_null() && unclaimed.insert(account).second)
+            unclaimed_total += pay["balance"].as<asset>().get_amount();
+      }
+   BOOST_REQUIRE_GT(unclaimed.size(), 3);
+
+   skipAhead(period_start_sec + 2 * period_seconds - 60);
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("no expired balances"), sweepclaims(N(bob111111111), 10));
+
+   // swept three rows at a time by anyone
+   skipAhead(period_start_sec + 2 * period_seconds);
+   auto carol = get_balance(N(carol1111111)).get_amount();
+   auto upay = get_balance(N(eosio.upay)).get_amount();
+   uint32_t calls = 0;
+   while (success() == sweepclaims(N(bob111111111), 3))
+   {
+      calls++;
+      produce_block();
+   }
+   BOOST_REQUIRE_EQUAL((unclaimed.size() + 2) / 3, calls);
+   BOOST_REQUIRE_EQUAL(carol + unclaimed_total, get_balance(N(carol1111111)).get_amount());
+   BOOST_REQUIRE_EQUAL(upay - unclaimed_total, get_balance(N(eosio.upay)).get_amount());
+   for (auto account : unclaimed)
+      BOOST_REQUIRE(get_account_pay(account).is_null());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_hash_votes, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   long period_start_sec = getSecondsSinceEpochUTC("2020-10-01 00:00:00");
+   time_point_sec period_start = time_point_sec(period_start_sec);
+   uint16_t dataset_batch_size = 2;
+   initresource(dataset_batch_size, 2, period_start, 60 * 60 * 24, 0.1, 0.2947);
+   resactivate(true);
+   produce_blocks(2);
+
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_75.json");
+   struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, dataset_batch_size);
+   for (auto oracle : {N(defproducera), N(defproducerb), N(defproducerc)})
+      BOOST_REQUIRE_EQUAL(success(),
+                          settotalusg(oracle, usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+
+   // a hash can only be voted for once its body has been uploaded
+   fc::sha256 first_hash = dataset_hash(usage_data.usage_datasets[0]);
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("dataset not found"), voteactusg(N(defproducerb), 1, first_hash, period_start));
+   BOOST_REQUIRE_EQUAL(error("missing authority of defproducerb"), push_oracle_action(N(defproducera), N(voteactusg), mvo()("source", N(defproducerb))("dataset_id", 1)("hash", first_hash)("period_start", period_start)));
+
+   // defproducera uploads every body, defproducerb follows with hashes and is paid out the same way
+   BOOST_REQUIRE_EQUAL(success(), addactusgm(N(defproducera), 1, usage_data.usage_datasets, period_start));
+   BOOST_REQUIRE(distribution_info(1).is_null());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("dataset_id differs from expected value"), voteactusg(N(defproducerb), 2, first_hash, period_start));
+   for (int i = 0; i < usage_data.usage_datasets.size(); i++)
+   {
+      BOOST_REQUIRE_EQUAL(success(), voteactusg(N(defproducerb), i + 1, dataset_hash(usage_data.usage_datasets[i]), period_start));
+      BOOST_REQUIRE(!distribution_info(i + 1).is_null());
+   }
+   distribute_datasets(usage_data.usage_datasets.size());
+   BOOST_REQUIRE(!get_account_pay(N(bp1)).is_null());
+   auto uploaded = system_usage_table_info(N(defproducera));
+   auto voted = system_usage_table_info(N(defproducerb));
+   BOOST_REQUIRE_EQUAL(uploaded["allocated_cpu"].as_uint64(), voted["allocated_cpu"].as_uint64());
+   BOOST_REQUIRE_EQUAL(fc::json::to_string(uploaded["merkle_peaks"]), fc::json::to_string(voted["merkle_peaks"]));
+
+   // the stored body is checked against the voter's own submissions, voting for it twice repeats its accounts
+   BOOST_REQUIRE_EQUAL(success(), voteactusg(N(defproducerc), 1, first_hash, period_start));
+   for (int i = 1; i < usage_data.usage_datasets.size(); i++)
+      BOOST_REQUIRE_EQUAL(success(), voteactusg(N(defproducerc), i + 1, dataset_hash(usage_data.usage_datasets[i]), period_start));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("duplicate or unordered account in usage data"),
+                       voteactusg(N(defproducerc), usage_data.usage_datasets.size() + 1, first_hash, period_start));
+
+   // followers committed to the same data so they score as if they had uploaded it
+   skipAhead(getSecondsSinceEpochUTC("2020-10-02 00:00:00"));
+   BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducera)));
+   BOOST_REQUIRE_EQUAL(10, sources_table_info(N(defproducera))["submissions_score"].as_uint64());
+   BOOST_REQUIRE_EQUAL(10, sources_table_info(N(defproducerb))["submissions_score"].as_uint64());
+   BOOST_REQUIRE_EQUAL(10, sources_table_info(N(defproducerc))["submissions_score"].as_uint64());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_distribute_worker, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   time_point_sec period_start = time_point_sec(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   uint16_t dataset_batch_size = 4;
+   initresource(dataset_batch_size, 2, period_start, 60 * 60 * 24, 0.1, 0.2947);
+   resactivate(true);
+   produce_blocks(2);
+
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_75.json");
+   struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, dataset_batch_size);
+   BOOST_REQUIRE_EQUAL(3, usage_data.usage_datasets.size());
+   for (auto oracle : {N(defproducera), N(defproducerb)})
+      BOOST_REQUIRE_EQUAL(success(),
+                          settotalusg(oracle, usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+
+   // consensus only queues the dataset
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducera), 1, usage_data.usage_datasets[0], period_start));
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("dataset not ready"), distribute(N(alice1111111), 1));
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerb), 1, usage_data.usage_datasets[0], period_start));
+   auto dist = distribution_info(1);
+   BOOST_REQUIRE_EQUAL(usage_data.usage_datasets[0].size(), dist["row_count"].as_uint64());
+   BOOST_REQUIRE_EQUAL(0, dist["next_row"].as_uint64());
+   BOOST_REQUIRE(get_account_pay(N(bp1)).is_null());
+
+   // anyone accrues it in slices
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("max_rows must be greater than 0"), distribute(N(alice1111111), 1, 0));
+   BOOST_REQUIRE_EQUAL(success(), distribute(N(alice1111111), 1, 3));
+   BOOST_REQUIRE_EQUAL(3, distribution_info(1)["next_row"].as_uint64());
+   BOOST_REQUIRE(!get_account_pay(N(bp3)).is_null());
+   BOOST_REQUIRE(get_account_pay(N(bp4)).is_null());
+   produce_block();
+   BOOST_REQUIRE_EQUAL(success(), distribute(N(bob111111111), 1, 3));
+   BOOST_REQUIRE_EQUAL(4, distribution_info(1)["next_row"].as_uint64());
+   BOOST_REQUIRE(!get_account_pay(N(bp4)).is_null());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("dataset already distributed"), distribute(N(alice1111111), 1));
+
+   // the payout matches the one accrued in a single call
+   int64_t utility_tokens = get_resource_history(1)["utility_tokens"].as<asset>().get_amount();
+   for (const auto &m : usage_data.usage_datasets[0])
+   {
+      int64_t amount = static_cast<int64_t>(static_cast<unsigned __int128>(m["u"].as_uint64()) * utility_tokens / usage_data.total_cpu_usage_us);
+      BOOST_REQUIRE_EQUAL(amount, get_account_pay(name(m["a"].as_string()))["balance"].as<asset>().get_amount());
+   }
+
+   // datasets nobody distributes are accrued by nextperiod before it clears the period
+   for (int i = 1; i < usage_data.usage_datasets.size(); i++)
+      for (auto oracle : {N(defproducera), N(defproducerb)})
+         BOOST_REQUIRE_EQUAL(success(), addactusg(oracle, i + 1, usage_data.usage_datasets[i], period_start));
+   skipAhead(getSecondsSinceEpochUTC("2020-10-02 00:00:00"));
+   BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducera), 3));
+   BOOST_REQUIRE_EQUAL(0, resource_conf_info()["rollover_stage"].as_uint64());
+   BOOST_REQUIRE_EQUAL(3, distribution_info(2)["next_row"].as_uint64());
+   BOOST_REQUIRE(sources_table_info(N(defproducera)).is_null());
+   for (int call = 0; call < 20 && resource_conf_info()["period_start"].as<time_point_sec>() == period_start; call++)
+   {
+      produce_block();
+      BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducera), 3));
+   }
+   BOOST_REQUIRE_EQUAL(period_start + 60 * 60 * 24, resource_conf_info()["period_start"].as<time_point_sec>());
+   for (const auto &dataset : usage_data.usage_datasets)
+      for (const auto &m : dataset)
+         BOOST_REQUIRE(!get_account_pay(name(m["a"].as_string())).is_null());
+   BOOST_REQUIRE_EQUAL(10, sources_table_info(N(defproducera))["submissions_score"].as_uint64());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_sorted_accrual, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   time_point_sec period_start = time_point_sec(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   initresource(10, 1, period_start, 60 * 60 * 24, 0.1, 0.2947);
+   resactivate(true);
+   produce_blocks(2);
+
+   // the fixture lists its accounts in name order
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_75.json");
+   fc::variants all_rows = usage_data_vo.get_array();
+   fc::variants every_other;
+   for (size_t i = 1; i < all_rows.size(); i += 2)
+      every_other.push_back(all_rows[i]);
+
+   map<name, int64_t> expected;
+   auto pay_period = [&](const fc::variants &rows, uint64_t history_id, uint16_t max_rows) {
+      time_point_sec open = resource_conf_info()["period_start"].as<time_point_sec>();
+      struct oracle_data usage_data = generate_all_data_hash(fc::variant(rows), 10);
+      BOOST_REQUIRE_EQUAL(success(), settotalusg(N(defproducera), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, open));
+      BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducera), 1, usage_data.usage_datasets[0], open));
+      distribute_datasets(1, max_rows);
+      int64_t utility_tokens = get_resource_history(history_id)["utility_tokens"].as<asset>().get_amount();
+      for (const auto &m : usage_data.usage_datasets[0])
+         expected[name(m["a"].as_string())] += static_cast<int64_t>(static_cast<unsigned __int128>(m["u"].as_uint64()) * utility_tokens / usage_data.total_cpu_usage_us);
+   };
+
+   // the second period merges into a table holding every other account, resuming mid dataset
+   pay_period(every_other, 1, 10);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-02 00:00:00"));
+   BOOST_REQUIRE_EQUAL(success(), nextperiod(N(defproducera)));
+   pay_period(all_rows, 2, 3);
+
+   for (const auto &e : expected)
+      BOOST_REQUIRE_EQUAL(e.second, get_account_pay(e.first)["balance"].as<asset>().get_amount());
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_dataset_gc, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   time_point_sec period_start = time_point_sec(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   uint16_t dataset_batch_size = 2;
+   initresource(dataset_batch_size, 2, period_start, 60 * 60 * 24, 0.1, 0.2947);
+   // unordered submissions, so one oracle can put the same body forward for several datasets
+   BOOST_REQUIRE_EQUAL(success(), setdedupe(0));
+   resactivate(true);
+   produce_blocks(2);
+
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_75.json");
+   struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, dataset_batch_size);
+   auto &datasets = usage_data.usage_datasets;
+   for (auto oracle : {N(defproducera), N(defproducerb), N(defproducerc), N(defproducerd)})
+      BOOST_REQUIRE_EQUAL(success(),
+                          settotalusg(oracle, usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+
+   auto body = [&](const vector<fc::variant> &dataset) {
+      string hash = dataset_hash(dataset).str();
+      for (const auto &row : period_rows(N(resusagedata), "datasets"))
+         if (row["hash"].as_string() == hash)
+            return row;
+      return fc::variant();
+   };
+   auto votes_for = [&](uint16_t dataset_id) {
+      size_t rows = 0;
+      for (const auto &row : period_rows(N(resconsensus), "consensus"))
+         rows += row["dataset_id"].as_uint64() == dataset_id;
+      return rows;
+   };
+
+   // defproducerc submits the second dataset's body as datasets 1 and 2 and a body of its own as dataset 3
+   vector<fc::variant> fake = datasets[2];
+   fake[0] = mvo()("a", "bp5")("u", "1000");
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerc), 1, datasets[1], period_start));
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerc), 2, datasets[1], period_start));
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerc), 3, fake, period_start));
+   BOOST_REQUIRE_EQUAL(2, body(datasets[1])["refs"].as_uint64());
+   BOOST_REQUIRE_EQUAL(2, period_rows(N(resusagedata), "datasets").size());
+
+   BOOST_REQUIRE_EQUAL(success(), addactusgm(N(defproducera), 1, datasets, period_start));
+   BOOST_REQUIRE_EQUAL(6, period_rows(N(resusagedata), "datasets").size());
+
+   // consensus on dataset 1 drops the vote for the other body, which dataset 2 still refers to
+   BOOST_REQUIRE_EQUAL(2, votes_for(1));
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerb), 1, datasets[0], period_start));
+   BOOST_REQUIRE_EQUAL(1, votes_for(1));
+   BOOST_REQUIRE_EQUAL(1, body(datasets[1])["refs"].as_uint64());
+
+   // the body only dataset 3 referred to is erased once that dataset is agreed
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerb), 2, datasets[1], period_start));
+   BOOST_REQUIRE(!body(fake).is_null());
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerb), 3, datasets[2], period_start));
+   BOOST_REQUIRE(body(fake).is_null());
+   BOOST_REQUIRE_EQUAL(5, period_rows(N(resusagedata), "datasets").size());
+   BOOST_REQUIRE_EQUAL(1, votes_for(3));
+
+   // late bodies which differ from the agreed one are committed to but not kept
+   BOOST_REQUIRE_EQUAL(success(), addactusg(N(defproducerd), 1, datasets[1], period_start));
+   BOOST_REQUIRE_EQUAL(1, votes_for(1));
+   BOOST_REQUIRE_EQUAL(5, period_rows(N(resusagedata), "datasets").size());
+   BOOST_REQUIRE_EQUAL(2, system_usage_table_info(N(defproducerd))["submission_count"].as_uint64());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("dataset not found"), voteactusg(N(defproducerd), 2, dataset_hash(fake), period_start));
+}
+FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE(resource_onblock_rollover, ux_system_tester)
+try
+{
+   using namespace std;
+   transfer(config::system_account_name, N(alice1111111), ram_core_sym::from_string("30.0000"), config::system_account_name);
+   produce_blocks(2);
+   skipAhead(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   active_and_vote_producers();
+   produce_blocks(2);
+
+   uint32_t period_seconds = 60 * 60 * 24;
+   time_point_sec period_start = time_point_sec(getSecondsSinceEpochUTC("2020-10-01 00:00:00"));
+   uint16_t dataset_batch_size = 2;
+   // straight through initinfl, so onblock's rollover keeps its default
+   BOOST_REQUIRE_EQUAL(success(), push_action(N(eosio), N(initinfl), mvo()("period_start", period_start)("initial_value_transfer_rate", 0.1)("max_pay_constant", 0.2947)));
+   BOOST_REQUIRE_EQUAL(success(), push_oracle_action(N(eosio.oracle), N(initresource), mvo()("dataset_batch_size", dataset_batch_size)("oracle_consensus_threshold", 2)("period_start", period_start)("period_seconds", period_seconds)));
+   BOOST_REQUIRE_EQUAL(100, inflation_conf_info()["rollover_rows"].as_uint64());
+   resactivate(true);
+   produce_blocks(2);
+
+   BOOST_REQUIRE_EQUAL(error("missing authority of eosio"), push_oracle_action(N(alice1111111), N(rollover), mvo()("max_rows", 10)));
+
+   fc::variant usage_data_vo = json_from_file_or_string("./tests/usage_data/usage_data_75.json");
+   struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, dataset_batch_size);
+   for (auto oracle : {N(defproducera), N(defproducerb)})
+   {
+      BOOST_REQUIRE_EQUAL(success(),
+                          settotalusg(oracle, usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
+      BOOST_REQUIRE_EQUAL(success(), addactusgm(oracle, 1, usage_data.usage_datasets, period_start));
+   }
+
+   // turned off, the ended period waits for nextperiod
+   BOOST_REQUIRE_EQUAL(success(), setrollover(0));
+   skipAhead(getSecondsSinceEpochUTC("2020-10-02 00:00:00"));
+   produce_blocks(4);
+   BOOST_REQUIRE_EQUAL(period_start, resource_conf_info()["period_start"].as<time_point_sec>());
+
+   // onblock rolls the period over a few rows per block
+   BOOST_REQUIRE_EQUAL(success(), setrollover(3));
+   BOOST_REQUIRE_EQUAL(3, inflation_conf_info()["rollover_rows"].as_uint64());
+   int blocks = 0;
+   for (; blocks < 100 && resource_conf_info()["period_start"].as<time_point_sec>() == period_start; blocks++)
+      produce_block();
+   BOOST_REQUIRE_GT(blocks, 1);
+   BOOST_REQUIRE_EQUAL(period_start + period_seconds, resource_conf_info()["period_start"].as<time_point_sec>());
+   BOOST_REQUIRE_EQUAL(0, resource_conf_info()["rollover_stage"].as_uint64());
+   BOOST_REQUIRE_EQUAL(10, sources_table_info(N(defproducera))["submissions_score"].as_uint64());
+   BOOST_REQUIRE(!get_account_pay(N(bpe)).is_null());
+   BOOST_REQUIRE(system_usage_table_info(N(defproducera), period_start).is_null());
+
+   // a period without modal data waits for it without failing onblock or scoring anyone twice
+   time_point_sec next_period_start = period_start + period_seconds;
+   BOOST_REQUIRE_EQUAL(success(),
+                       settotalusg(N(defproducera), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, next_period_start));
+   skipAhead(getSecondsSinceEpochUTC("2020-10-03 00:00:00"));
+   auto unpaid_blocks = get_global_state()["total_unpaid_blocks"].as<uint32_t>();
+   produce_blocks(10);
+   BOOST_REQUIRE_LT(unpaid_blocks, get_global_state()["total_unpaid_blocks"].as<uint32_t>());
+   BOOST_REQUIRE_EQUAL(next_period_start, resource_conf_info()["period_start"].as<time_point_sec>());
+   BOOST_REQUIRE_EQUAL(1, sources_table_info(N(defproducera))["submissions_count"].as_uint64());
+   BOOST_REQUIRE_EQUAL(wasm_assert_msg("full modal data not received"), nextperiod(N(defproducera)));
+
+   // its steps get further apart the longer it waits instead of being scheduled every block
+   produce_block(fc::hours(1));
+   time_point_sec waited = time_point_sec(control->head_block_time());
+   produce_blocks(10);
+   BOOST_REQUIRE_EQUAL(waited + 10 * 60, inflation_conf_info()["next_rollover_step"].as<time_point_sec>());
+   BOOST_REQUIRE_EQUAL(next_period_start, resource_conf_info()["period_start"].as<time_point_sec>());
+}
+FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE(test_10_percent_inflation, ux_system_tester)
 try
 {
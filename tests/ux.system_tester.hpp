@@ -5,6 +5,7 @@
 #include <eosio/chain/resource_limits.hpp>
 #include "contracts.hpp"
 #include "ux_test_symbol.hpp"
+#include "ux.usage_data.hpp"
 
 #include <fc/variant_object.hpp>
 #include <fstream>
@@ -35,7 +36,12 @@ namespace eosio_system
          produce_blocks(2);
 
          create_accounts({N(eosio.token), N(eosio.ram), N(eosio.ramfee), N(eosio.stake),
-                          N(eosio.bpay), N(eosio.saving), N(eosio.names), N(eosio.rex), N(eosio.upay)});
+                          N(eosio.bpay), N(eosio.saving), N(eosio.names), N(eosio.rex), N(eosio.upay), N(eosio.oracle)});
+
+         // eosio.oracle sends issueinfl under its own authority and pays out of eosio.upay
+         for (auto account : {N(eosio.oracle), N(eosio.upay)})
+            set_authority(account, config::active_name,
+                          authority(1, {key_weight{get_public_key(account, "active"), 1}}, {permission_level_weight{{N(eosio.oracle), config::eosio_code_name}, 1}}));
 
          produce_blocks(100);
          set_code(N(eosio.token), contracts::token_wasm());
@@ -76,6 +82,15 @@ namespace eosio_system
             BOOST_REQUIRE_EQUAL(abi_serializer::to_abi(accnt.abi, abi), true);
             abi_ser.set_abi(abi, abi_serializer_max_time);
          }
+
+         set_code(N(eosio.oracle), contracts::oracle_wasm());
+         set_abi(N(eosio.oracle), contracts::oracle_abi().data());
+         {
+            const auto &accnt = control->db().get<account_object, by_name>(N(eosio.oracle));
+            abi_def abi;
+            BOOST_REQUIRE_EQUAL(abi_serializer::to_abi(accnt.abi, abi), true);
+            oracle_abi_ser.set_abi(abi, abi_serializer_max_time);
+         }
       }
 
       void remaining_setup()
@@ -283,6 +298,17 @@ namespace eosio_system
          return base_tester::push_action(std::move(act), (auth ? signer : signer == N(bob111111111) ? N(alice1111111) : N(bob111111111)).to_uint64_t());
       }
 
+      // eosio.oracle action, resource usage reporting and payouts live there
+      action_result push_oracle_action(const account_name &signer, const action_name &name, const variant_object &data)
+      {
+         action act;
+         act.account = N(eosio.oracle);
+         act.name = name;
+         act.data = oracle_abi_ser.variant_to_binary(oracle_abi_ser.get_action_type(name), data, abi_serializer_max_time);
+
+         return base_tester::push_action(std::move(act), signer.to_uint64_t());
+      }
+
       action_result stake(const account_name &from, const account_name &to, const asset &net, const asset &cpu)
       {
          return push_action(name(from), N(delegatebw), mvo()("from", from)("receiver", to)("stake_net_quantity", net)("stake_cpu_quantity", cpu)("transfer", 0));
@@ -1073,19 +1099,110 @@ namespace eosio_system
          return data.empty() ? fc::variant() : abi_ser.binary_to_variant("system_usage_history", data, abi_serializer_max_time);
       }
 
+      // store a contract table row as an earlier contract version left it, on the validating node as well
+      void set_table_row(name code, name scope, name table, uint64_t primary_key, const vector<char> &value)
+      {
+         auto write = [&](chainbase::database &db) {
+            const auto *t_id = db.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(code, scope, table));
+            if (!t_id)
+            {
+               t_id = &db.create<chain::table_id_object>([&](auto &t) {
+                  t.code = code;
+                  t.scope = scope;
+                  t.table = table;
+                  t.payer = code;
+               });
+            }
+            const auto *row = db.find<chain::key_value_object, chain::by_scope_primary>(boost::make_tuple(t_id->id, primary_key));
+            if (row)
+            {
+               db.modify(*row, [&](auto &o) { o.value.assign(value.data(), value.size()); });
+               return;
+            }
+            db.create<chain::key_value_object>([&](auto &o) {
+               o.t_id = t_id->id;
+               o.primary_key = primary_key;
+               o.payer = code;
+               o.value.assign(value.data(), value.size());
+            });
+            db.modify(*t_id, [](auto &t) { t.count++; });
+         };
+         write(control->mutable_db());
+#ifndef NON_VALIDATING_TEST
+         write(validating_node->mutable_db());
+#endif
+      }
+
+      // eosio.system's resourceconf as written before hash_version, the trailing binary extensions left out
+      void set_legacy_resource_config(time_point_sec period_start, bool inflation_transferred, vector<uint16_t> account_distributions_made = {},
+                                      uint32_t emadraglimit = 2)
+      {
+         auto conf = mvo()("period_seconds", 86400)("oracle_consensus_threshold", 1)("dataset_batch_size", 100)("period_start", period_start)
+            ("submitting_oracles", vector<name>())("inflation_transferred", inflation_transferred)("account_distributions_made", account_distributions_made)
+            ("emadraglimit", emadraglimit)("initial_value_transfer_rate", 0.1)("max_pay_constant", 0.2947)("last_period_inflation_print", time_point_sec())("active", true);
+         set_table_row(config::system_account_name, config::system_account_name, N(resourceconf), N(resourceconf).to_uint64_t(),
+                       abi_ser.variant_to_binary("legacy_resource_config_state", conf, abi_serializer_max_time));
+      }
+
+      // resaccpay and ressources rows of eosio.system, written without secondary index entries as the first versions left them
+      void set_legacy_account_pay(name account, asset balance, time_point_sec timestamp)
+      {
+         set_table_row(config::system_account_name, config::system_account_name, N(resaccpay), account.to_uint64_t(),
+                       abi_ser.variant_to_binary("legacy_account_pay", mvo()("account", account)("balance", balance)("timestamp", timestamp), abi_serializer_max_time));
+      }
+
+      void set_legacy_source(name account, uint32_t submissions_score, uint32_t submissions_count)
+      {
+         set_table_row(config::system_account_name, config::system_account_name, N(ressources), account.to_uint64_t(),
+                       abi_ser.variant_to_binary("legacy_sources", mvo()("account", account)("submissions_score", submissions_score)("submissions_count", submissions_count), abi_serializer_max_time));
+      }
+
+      // a leftover eosio.system period table row, only its leading key fields written
+      void set_legacy_period_row(name scope, name table, uint64_t primary_key, const string &type, const fc::variant &row)
+      {
+         set_table_row(config::system_account_name, scope, table, primary_key, abi_ser.variant_to_binary(type, row, abi_serializer_max_time));
+      }
+
+      action_result migrateres(uint16_t max_rows)
+      {
+         return push_action(N(eosio), N(migrateres), mvo()("max_rows", max_rows));
+      }
+
       action_result resactivate(bool active)
       {
-         return push_action(N(eosio), N(resactivate), mvo()("active", active));
+         return push_oracle_action(N(eosio.oracle), N(resactivate), mvo()("active", active));
       }
 
+      // eosio.system inflation settings first, eosio.oracle reads the history row they create
+      // onblock's rollover is turned off so tests drive the periods with nextperiod, resource_onblock_rollover turns it back on
       action_result initresource(uint16_t dataset_batch_size, uint16_t oracle_consensus_threshold, time_point_sec period_start, uint32_t period_seconds, float initial_value_transfer_rate, float max_pay_constant)
       {
-         return push_action(N(eosio), N(initresource), mvo()("dataset_batch_size", dataset_batch_size)("oracle_consensus_threshold", oracle_consensus_threshold)("period_start", period_start)("period_seconds", period_seconds)("initial_value_transfer_rate", initial_value_transfer_rate)("max_pay_constant", max_pay_constant));
+         action_result res = push_action(N(eosio), N(initinfl), mvo()("period_start", period_start)("initial_value_transfer_rate", initial_value_transfer_rate)("max_pay_constant", max_pay_constant));
+         if (res == success())
+            res = setrollover(0);
+         if (res != success())
+            return res;
+         return push_oracle_action(N(eosio.oracle), N(initresource), mvo()("dataset_batch_size", dataset_batch_size)("oracle_consensus_threshold", oracle_consensus_threshold)("period_start", period_start)("period_seconds", period_seconds));
+      }
+
+      action_result sethashver(uint8_t hash_version)
+      {
+         return push_oracle_action(N(eosio.oracle), N(sethashver), mvo()("hash_version", hash_version));
+      }
+
+      action_result setdraglimit(uint32_t emadraglimit)
+      {
+         return push_action(N(eosio), N(setdraglimit), mvo()("emadraglimit", emadraglimit));
+      }
+
+      action_result setrollover(uint16_t rollover_rows)
+      {
+         return push_action(N(eosio), N(setrollover), mvo()("rollover_rows", rollover_rows));
       }
 
       action_result settotalusg(name source, uint64_t total_cpu_us, uint64_t total_net_words, string all_data_hash, time_point_sec period_start)
       {
-         return push_action(source, N(settotalusg), mvo()("source", source)("total_cpu_us", total_cpu_us)("total_net_words", total_net_words)("all_data_hash", all_data_hash)("period_start", period_start));
+         return push_oracle_action(source, N(settotalusg), mvo()("source", source)("total_cpu_us", total_cpu_us)("total_net_words", total_net_words)("all_data_hash", all_data_hash)("period_start", period_start));
       }
 
       fc::variant json_from_file_or_string(const string &file_or_str, fc::json::parse_type ptype = fc::json::parse_type::legacy_parser)
@@ -1110,22 +1227,156 @@ namespace eosio_system
          }
       }
 
-      action_result addactusg(name source, uint16_t dataset_id, vector<fc::variant> &data, time_point_sec period_start)
+      action_result addactusg(name source, uint16_t dataset_id, const vector<fc::variant> &data, time_point_sec period_start)
       {
          //fc::variant dataset = json_from_file_or_string(data);
-         return push_action(source, N(addactusg), mvo()("source", source)("dataset_id", dataset_id)("dataset", data)("period_start", period_start));
+         return push_oracle_action(source, N(addactusg), mvo()("source", source)("dataset_id", dataset_id)("dataset", data)("period_start", period_start));
       }
 
-      action_result nextperiod(name source)
+      action_result addactusgz(name source, uint16_t dataset_id, const vector<char> &payload, time_point_sec period_start)
       {
-         //fc::variant dataset = json_from_file_or_string(data);
-         return push_action(source, N(nextperiod), mvo());
+         return push_oracle_action(source, N(addactusgz), mvo()("source", source)("dataset_id", dataset_id)("payload", payload)("period_start", period_start));
+      }
+
+      action_result addactusgm(name source, uint16_t first_dataset_id, const vector<vector<fc::variant>> &datasets, time_point_sec period_start)
+      {
+         return push_oracle_action(source, N(addactusgm), mvo()("source", source)("first_dataset_id", first_dataset_id)("datasets", datasets)("period_start", period_start));
+      }
+
+      action_result voteactusg(name source, uint16_t dataset_id, const fc::sha256 &hash, time_point_sec period_start)
+      {
+         return push_oracle_action(source, N(voteactusg), mvo()("source", source)("dataset_id", dataset_id)("hash", hash)("period_start", period_start));
+      }
+
+      // hash_version 1 hash of a dataset in the addactusg variant format, as voted for with voteactusg
+      static fc::sha256 dataset_hash(const vector<fc::variant> &dataset)
+      {
+         vector<std::pair<account_name, uint64_t>> metrics;
+         metrics.reserve(dataset.size());
+         for (const auto &row : dataset)
+            metrics.emplace_back(account_name(row["a"].as_string()), row["u"].as_uint64());
+         return hash_metrics(metrics);
+      }
+
+      static void write_varint(vector<char> &out, uint64_t value)
+      {
+         do
+         {
+            uint8_t byte = value & 0x7f;
+            value >>= 7;
+            out.push_back(static_cast<char>(value ? byte | 0x80 : byte));
+         } while (value);
+      }
+
+      // addactusgz payload for rows already sorted by account name
+      static vector<char> encode_usage(const vector<fc::variant> &data)
+      {
+         vector<char> payload;
+         write_varint(payload, data.size());
+         uint64_t previous = 0;
+         for (const auto &row : data)
+         {
+            uint64_t account = account_name(row["a"].as_string()).to_uint64_t();
+            write_varint(payload, account - previous);
+            write_varint(payload, row["u"].as_uint64());
+            previous = account;
+         }
+         return payload;
+      }
+
+      action_result nextperiod(name source, uint16_t max_rows = 500)
+      {
+         return push_oracle_action(source, N(nextperiod), mvo()("max_rows", max_rows));
+      }
+
+      // eosio.oracle action pushed as its own transaction, the trace carries the billed cpu and net
+      transaction_trace_ptr push_action_trace(name signer, name action, const variant_object &data)
+      {
+         return base_tester::push_action(N(eosio.oracle), action, signer, data);
+      }
+
+      transaction_trace_ptr nextperiod_trace(name source, uint16_t max_rows)
+      {
+         return base_tester::push_action(N(eosio.oracle), N(nextperiod), source, mvo()("max_rows", max_rows));
+      }
+
+      action_result distribute(name caller, uint16_t dataset_id, uint16_t max_rows = 500)
+      {
+         return push_oracle_action(caller, N(distribute), mvo()("dataset_id", dataset_id)("max_rows", max_rows));
+      }
+
+      // accrue every queued dataset of the open period with ids 1 to count
+      void distribute_datasets(uint16_t count, uint16_t max_rows = 500)
+      {
+         for (uint16_t id = 1; id <= count; id++)
+         {
+            for (auto dist = distribution_info(id); !dist.is_null() && dist["next_row"].as_uint64() < dist["row_count"].as_uint64(); dist = distribution_info(id))
+               BOOST_REQUIRE_EQUAL(success(), distribute(N(eosio), id, max_rows));
+         }
       }
 
       action_result claimdistrib(name account)
       {
          //fc::variant dataset = json_from_file_or_string(data);
-         return push_action(account, N(claimdistrib), mvo()("account", account));
+         return push_oracle_action(account, N(claimdistrib), mvo()("account", account));
+      }
+
+      // let relayer sign claimmany for account through a claim permission linked to it
+      void delegate_claim(name account, name relayer)
+      {
+         set_authority(account, N(claim), authority(1, {}, {permission_level_weight{{relayer, config::active_name}, 1}}), config::active_name);
+         link_authority(account, N(eosio.oracle), N(claim), N(claimmany));
+      }
+
+      // claimmany carrying each account's claim permission, signed by the relayer alone
+      action_result claimmany(name relayer, const vector<name> &accounts, name permission = N(claim))
+      {
+         action act;
+         act.account = N(eosio.oracle);
+         act.name = N(claimmany);
+         act.data = oracle_abi_ser.variant_to_binary(oracle_abi_ser.get_action_type(N(claimmany)), mvo()("accounts", accounts), abi_serializer_max_time);
+         for (const auto &account : std::set<name>(accounts.begin(), accounts.end()))
+            act.authorization.push_back(permission_level{account, permission});
+
+         signed_transaction trx;
+         trx.actions.emplace_back(std::move(act));
+         set_transaction_headers(trx);
+         trx.sign(get_private_key(relayer, "active"), control->get_chain_id());
+         try
+         {
+            push_transaction(trx);
+         }
+         catch (const fc::exception &ex)
+         {
+            return error(ex.top_message());
+         }
+         produce_block();
+         return success();
+      }
+
+      action_result claimproof(name account, time_point_sec period_start, uint16_t dataset_id, uint32_t leaf_index, asset amount, const vector<fc::sha256> &proof)
+      {
+         return push_oracle_action(account, N(claimproof), mvo()("account", account)("period_start", period_start)("dataset_id", dataset_id)("leaf_index", leaf_index)("amount", amount)("proof", proof));
+      }
+
+      action_result setdistmode(uint8_t distribution_mode)
+      {
+         return push_oracle_action(N(eosio.oracle), N(setdistmode), mvo()("distribution_mode", distribution_mode));
+      }
+
+      action_result setdedupe(uint8_t dedupe_mode)
+      {
+         return push_oracle_action(N(eosio.oracle), N(setdedupe), mvo()("dedupe_mode", dedupe_mode));
+      }
+
+      action_result setclaimexp(uint32_t claim_expiry_seconds, name sweep_account)
+      {
+         return push_oracle_action(N(eosio.oracle), N(setclaimexp), mvo()("claim_expiry_seconds", claim_expiry_seconds)("sweep_account", sweep_account));
+      }
+
+      action_result sweepclaims(name caller, uint16_t max_rows)
+      {
+         return push_oracle_action(caller, N(sweepclaims), mvo()("max_rows", max_rows));
       }
 
       long getSecondsSinceEpochUTC(const string &timestamp)
@@ -1154,11 +1405,11 @@ namespace eosio_system
          produce_block(fc::seconds(diff));
       }
 
-      void dayCycle(string fixture, uint32_t period_start_sec, uint8_t dataset_batch_size)
+      void dayCycle(string fixture, uint32_t period_start_sec, uint8_t dataset_batch_size, uint8_t hash_version = 1)
       {
          time_point_sec period_start = time_point_sec(period_start_sec);
          fc::variant usage_data_vo = json_from_file_or_string(fixture);
-         struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, dataset_batch_size);
+         struct oracle_data usage_data = generate_all_data_hash(usage_data_vo, dataset_batch_size, 1, hash_version);
          // Set totals for oracle 1
          BOOST_REQUIRE_EQUAL(success(),
                              settotalusg(N(defproducerb), usage_data.total_cpu_usage_us, usage_data.total_net_usage_words, usage_data.all_data_hash, period_start));
@@ -1171,18 +1422,141 @@ namespace eosio_system
          }
       }
 
-      // function for converting checksum256 into string
-      template <typename CharT>
-      static std::string to_hex(const CharT *d, uint32_t s)
+      struct usage_commitment
       {
-         std::string r;
-         const char *to_hex = "0123456789abcdef";
-         uint8_t *c = (uint8_t *)d;
-         for (uint32_t i = 0; i < s; ++i)
+         string all_data_hash;
+         uint64_t total_cpu_usage_us = 0;
+         uint64_t total_net_usage_words = 0;
+         uint64_t datasets = 0;
+      };
+
+      static fc::sha256 hash_usage_batch(const vector<ux_usage_data::usage_row> &batch, uint8_t hash_version)
+      {
+         if (hash_version == 0)
          {
-            (r += to_hex[(c[i] >> 4)]) += to_hex[(c[i] & 0x0f)];
+            string text;
+            for (const auto &row : batch)
+               text += name(row.account).to_string() + std::to_string(row.cpu_us);
+            return fc::sha256::hash(text.c_str(), text.size());
          }
-         return r;
+         vector<std::pair<account_name, uint64_t>> metrics;
+         metrics.reserve(batch.size());
+         for (const auto &row : batch)
+            metrics.emplace_back(name(row.account), row.cpu_us);
+         return hash_metrics(metrics);
+      }
+
+      // generate_all_data_hash over a streamed source, holding one batch and the dataset hashes rather than every row
+      template <typename Source>
+      usage_commitment stream_all_data_hash(Source &source, uint32_t dataset_batch_size, uint8_t hash_version = 1)
+      {
+         usage_commitment res;
+         vector<fc::sha256> hashes(1);
+         vector<ux_usage_data::usage_row> batch;
+         ux_usage_data::usage_row row;
+         source.reset();
+         for (bool more = source.next(row); more || !batch.empty();)
+         {
+            if (more)
+            {
+               res.total_cpu_usage_us += row.cpu_us;
+               res.total_net_usage_words += row.net_words;
+               batch.push_back(row);
+               more = source.next(row);
+            }
+            if (batch.size() == dataset_batch_size || (!more && !batch.empty()))
+            {
+               hashes.push_back(hash_usage_batch(batch, hash_version));
+               batch.clear();
+            }
+         }
+         if (hash_version == 0)
+         {
+            string total_usage_string = std::to_string(res.total_cpu_usage_us) + "-" + std::to_string(res.total_net_usage_words);
+            hashes[0] = fc::sha256::hash(total_usage_string.c_str(), total_usage_string.size());
+         }
+         else
+         {
+            hashes[0] = hash_metrics({{N(cpu.us), res.total_cpu_usage_us}, {N(net.words), res.total_net_usage_words}});
+         }
+         res.all_data_hash = merkle_root(hashes, 0, hashes.size()).str();
+         res.datasets = hashes.size() - 1;
+         return res;
+      }
+
+      // second pass, calls f(dataset_id, dataset) with each batch in the addactusg variant format
+      template <typename Source, typename F>
+      void stream_usage_batches(Source &source, uint32_t dataset_batch_size, F &&f)
+      {
+         vector<fc::variant> batch;
+         ux_usage_data::usage_row row;
+         uint16_t dataset_id = 1;
+         source.reset();
+         for (bool more = source.next(row); more || !batch.empty();)
+         {
+            if (more)
+            {
+               batch.emplace_back(mvo()("a", name(row.account).to_string())("u", std::to_string(row.cpu_us))("net", std::to_string(row.net_words)));
+               more = source.next(row);
+            }
+            if (batch.size() == dataset_batch_size || (!more && !batch.empty()))
+            {
+               f(dataset_id++, batch);
+               batch.clear();
+            }
+         }
+      }
+
+      // hash two merkle nodes into their parent
+      static fc::sha256 merkle_parent(const fc::sha256 &left, const fc::sha256 &right)
+      {
+         char buf[64];
+         memcpy(buf, left.data(), 32);
+         memcpy(buf + 32, right.data(), 32);
+         return fc::sha256::hash(buf, sizeof(buf));
+      }
+
+      // merkle root of leaves[begin, end) using the RFC 6962 tree shape (left subtree is the largest power of two)
+      static fc::sha256 merkle_root(const vector<fc::sha256> &leaves, size_t begin, size_t end)
+      {
+         if (end - begin == 1)
+            return leaves[begin];
+         size_t split = 1;
+         while (split * 2 < end - begin)
+            split *= 2;
+         return merkle_parent(merkle_root(leaves, begin, begin + split), merkle_root(leaves, begin + split, end));
+      }
+
+      // audit path of leaves[index] within leaves[begin, end), RFC 9162 PATH order (nearest sibling first)
+      static vector<fc::sha256> merkle_proof(const vector<fc::sha256> &leaves, size_t index, size_t begin, size_t end)
+      {
+         if (end - begin == 1)
+            return {};
+         size_t split = 1;
+         while (split * 2 < end - begin)
+            split *= 2;
+         vector<fc::sha256> proof;
+         if (index < begin + split)
+         {
+            proof = merkle_proof(leaves, index, begin, begin + split);
+            proof.push_back(merkle_root(leaves, begin + split, end));
+         }
+         else
+         {
+            proof = merkle_proof(leaves, index, begin + split, end);
+            proof.push_back(merkle_root(leaves, begin, begin + split));
+         }
+         return proof;
+      }
+
+      // packed claim_leaf, as hashed by the contract for distribution_mode 1
+      static fc::sha256 claim_leaf_hash(uint32_t index, account_name account, int64_t amount)
+      {
+         fc::sha256::encoder enc;
+         fc::raw::pack(enc, index);
+         fc::raw::pack(enc, account);
+         fc::raw::pack(enc, amount);
+         return enc.result();
       }
 
       struct oracle_data
@@ -1193,65 +1567,150 @@ namespace eosio_system
          uint64_t total_net_usage_words = 0;
       };
 
-      struct oracle_data generate_all_data_hash(fc::variant all_data, int dataset_batch_size, uint8_t divisor = 1)
+      // packed binary layout of std::vector<metric>, as hashed by the contract for hash_version 1
+      static fc::sha256 hash_metrics(const vector<std::pair<account_name, uint64_t>> &metrics)
+      {
+         auto packed = fc::raw::pack(metrics);
+         return fc::sha256::hash(packed.data(), packed.size());
+      }
+
+      struct oracle_data generate_all_data_hash(fc::variant all_data, int dataset_batch_size, uint8_t divisor = 1, uint8_t hash_version = 1)
       {
          using namespace std;
 
          uint64_t total_cpu_usage_us = 0;
          uint64_t total_net_usage_words = 0;
 
-         vector<string> usage_dataset_hashes;
+         vector<fc::sha256> usage_dataset_hashes;
          vector<vector<fc::variant>> usage_datasets;
 
          fc::variants &data_variants = all_data.get_array();
          for (int i = 0; i < data_variants.size(); i = i + dataset_batch_size)
          {
             string individual_usage_string;
+            vector<std::pair<account_name, uint64_t>> individual_usage_metrics;
             vector<fc::variant> individual_usage_data;
             int max = data_variants.size() > i + dataset_batch_size ? i + dataset_batch_size : data_variants.size();
             for (int j = i; j < max; j++)
             {
                fc::variant_object &vo = data_variants[j].get_object();
                fc::mutable_variant_object mvo = vo;
-               individual_usage_string += mvo["a"].as_string() + mvo["u"].as_string();
+               if (hash_version == 0)
+                  individual_usage_string += mvo["a"].as_string() + mvo["u"].as_string();
+               else
+                  individual_usage_metrics.emplace_back(account_name(mvo["a"].as_string()), mvo["u"].as_uint64());
                total_cpu_usage_us += mvo["u"].as_uint64();
                total_net_usage_words += mvo["net"].as_uint64();
                individual_usage_data.emplace_back(data_variants[j]);
             }
-            string individual_usage_hash = fc::sha256::hash((const char *)individual_usage_string.c_str(), individual_usage_string.size());
+            fc::sha256 individual_usage_hash = hash_version == 0
+                                                   ? fc::sha256::hash((const char *)individual_usage_string.c_str(), individual_usage_string.size())
+                                                   : hash_metrics(individual_usage_metrics);
             usage_dataset_hashes.emplace_back(individual_usage_hash);
             usage_datasets.emplace_back(individual_usage_data);
          }
 
-         string total_usage_string = std::to_string(total_cpu_usage_us) + "-" + std::to_string(total_net_usage_words);
-         string total_usage_hash = fc::sha256::hash((const char *)total_usage_string.c_str(), total_usage_string.size());
-         usage_dataset_hashes.emplace(usage_dataset_hashes.begin(), total_usage_hash);
-         string all_data_hash_string;
-         for (int i = 0; i < usage_dataset_hashes.size(); i++)
+         fc::sha256 total_usage_hash;
+         if (hash_version == 0)
+         {
+            string total_usage_string = std::to_string(total_cpu_usage_us) + "-" + std::to_string(total_net_usage_words);
+            total_usage_hash = fc::sha256::hash((const char *)total_usage_string.c_str(), total_usage_string.size());
+         }
+         else
          {
-            all_data_hash_string += usage_dataset_hashes[i];
-            if (i != usage_dataset_hashes.size() - 1)
-               all_data_hash_string += "-";
+            total_usage_hash = hash_metrics({{N(cpu.us), total_cpu_usage_us}, {N(net.words), total_net_usage_words}});
          }
-         string all_data_hash = fc::sha256::hash((const char *)all_data_hash_string.c_str(), all_data_hash_string.size());
+         usage_dataset_hashes.emplace(usage_dataset_hashes.begin(), total_usage_hash);
+         string all_data_hash = merkle_root(usage_dataset_hashes, 0, usage_dataset_hashes.size()).str();
          struct oracle_data usage_data = {usage_datasets, all_data_hash, total_cpu_usage_us, total_net_usage_words};
          return usage_data;
       }
 
       abi_serializer abi_ser;
       abi_serializer token_abi_ser;
+      abi_serializer oracle_abi_ser;
 
       fc::variant resource_conf_info()
       {
-         vector<char> data = get_row_by_account(config::system_account_name, config::system_account_name, N(resourceconf), N(resourceconf));
-         return data.empty() ? fc::variant() : abi_ser.binary_to_variant("resource_config_state", data, abi_serializer_max_time);
+         vector<char> data = get_row_by_account(N(eosio.oracle), N(eosio.oracle), N(resourceconf), N(resourceconf));
+         return data.empty() ? fc::variant() : oracle_abi_ser.binary_to_variant("resource_config_state", data, abi_serializer_max_time);
+      }
+
+      fc::variant inflation_conf_info()
+      {
+         vector<char> data = get_row_by_account(config::system_account_name, config::system_account_name, N(resinflconf), N(resinflconf));
+         return data.empty() ? fc::variant() : abi_ser.binary_to_variant("inflation_config_state", data, abi_serializer_max_time);
+      }
+
+      // every row of a resource period table in primary key order, e.g. resconsensus as "consensus"
+      fc::variants period_rows(name table, const string &type, time_point_sec period_start = time_point_sec())
+      {
+         fc::variants rows;
+         const auto &db = control->db();
+         const auto *t_id = db.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(N(eosio.oracle), period_scope(period_start), table));
+         if (!t_id)
+            return rows;
+
+         const auto &idx = db.get_index<chain::key_value_index, chain::by_scope_primary>();
+         for (auto itr = idx.lower_bound(boost::make_tuple(t_id->id)); itr != idx.end() && itr->t_id == t_id->id; itr++)
+         {
+            vector<char> data(itr->value.size());
+            memcpy(data.data(), itr->value.data(), data.size());
+            rows.push_back(oracle_abi_ser.binary_to_variant(type, data, abi_serializer_max_time));
+         }
+         return rows;
+      }
+
+      // rows a resource table holds, from the chain's row count for the table
+      uint32_t table_row_count(name scope, name table, name code = N(eosio.oracle))
+      {
+         const auto *t_id = control->db().find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(code, scope, table));
+         return t_id ? t_id->count : 0;
+      }
+
+      fc::variant get_account_pay(name account)
+      {
+         vector<char> data = get_row_by_account(N(eosio.oracle), N(eosio.oracle), N(resaccpay), account);
+         return data.empty() ? fc::variant() : oracle_abi_ser.binary_to_variant("account_pay", data, abi_serializer_max_time);
+      }
+
+      // scope of the period tables, the open period when none is given
+      name period_scope(time_point_sec period_start = time_point_sec())
+      {
+         if (period_start == time_point_sec())
+            period_start = resource_conf_info()["period_start"].as<time_point_sec>();
+         return name(uint64_t(period_start.sec_since_epoch()));
       }
 
-      fc::variant system_usage_table_info(name oracle)
+      fc::variant distribution_info(uint16_t dataset_id, time_point_sec period_start = time_point_sec())
+      {
+         vector<char> data = get_row_by_account(N(eosio.oracle), period_scope(period_start), N(resdistrib), name(dataset_id));
+         return data.empty() ? fc::variant() : oracle_abi_ser.binary_to_variant("dataset_distribution", data, abi_serializer_max_time);
+      }
+
+      fc::variant claim_root_info(uint64_t id)
+      {
+         vector<char> data = get_row_by_account(N(eosio.oracle), N(eosio.oracle), N(resclaims), name(id));
+         return data.empty() ? fc::variant() : oracle_abi_ser.binary_to_variant("claim_root", data, abi_serializer_max_time);
+      }
+
+      fc::variant oracle_set_info()
+      {
+         vector<char> data = get_row_by_account(config::system_account_name, config::system_account_name, N(resoracles), N(resoracles));
+         return data.empty() ? fc::variant() : abi_ser.binary_to_variant("oracle_set", data, abi_serializer_max_time);
+      }
+
+      fc::variant system_usage_table_info(name oracle, time_point_sec period_start = time_point_sec())
       {
          name table_name = N(ressysusage);
-         vector<char> data = get_row_by_account(config::system_account_name, config::system_account_name, table_name, account_name(oracle));
-         return data.empty() ? fc::variant() : abi_ser.binary_to_variant("system_usage", data, abi_serializer_max_time);
+         vector<char> data = get_row_by_account(N(eosio.oracle), period_scope(period_start), table_name, account_name(oracle));
+         return data.empty() ? fc::variant() : oracle_abi_ser.binary_to_variant("system_usage", data, abi_serializer_max_time);
+      }
+
+      fc::variant sources_table_info(name oracle)
+      {
+         vector<char> data = get_row_by_account(N(eosio.oracle), N(eosio.oracle), N(ressources), account_name(oracle));
+         return data.empty() ? fc::variant() : oracle_abi_ser.binary_to_variant("sources", data, abi_serializer_max_time);
       }
    };
 
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <fc/exception/exception.hpp>
+#include <ux.aggregator/aggregator.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// usage sources for scale tests, each yields rows one at a time and can be rewound for a second pass
+namespace ux_usage_data
+{
+   using ux::aggregator::usage_row;
+
+   // deterministic synthetic usage with a pareto distributed cpu per account, so a few accounts dominate as on a real chain
+   // account names are "usg" and five base 31 characters in ascending name order, which allows up to 31^5 accounts
+   class usage_generator
+   {
+   public:
+      usage_generator(uint64_t seed, uint64_t accounts, double alpha = 1.2, uint64_t min_cpu_us = 100, uint64_t max_cpu_us = 10000000)
+          : seed(seed), accounts(accounts), alpha(alpha), min_cpu_us(min_cpu_us), max_cpu_us(max_cpu_us)
+      {
+         FC_ASSERT(accounts <= 28629151, "usage_generator names allow at most 31^5 accounts");
+         reset();
+      }
+
+      void reset()
+      {
+         state = seed;
+         index = 0;
+      }
+
+      bool next(usage_row &row)
+      {
+         if (index == accounts)
+            return false;
+         static const char charmap[] = "12345abcdefghijklmnopqrstuvwxyz";
+         std::string account = "usg";
+         for (uint64_t d = 31 * 31 * 31 * 31; d > 0; d /= 31)
+            account += charmap[index / d % 31];
+         index++;
+
+         // inverse transform of a uniform draw in (0, 1]
+         double uniform = double((splitmix() >> 11) + 1) * (1.0 / 9007199254740992.0);
+         double cpu = double(min_cpu_us) * std::pow(uniform, -1.0 / alpha);
+         row.account = ux::aggregator::string_to_name(account);
+         row.cpu_us = cpu >= double(max_cpu_us) ? max_cpu_us : static_cast<uint64_t>(cpu);
+         row.net_words = row.cpu_us * (200 + splitmix() % 600) / 1000;
+         return true;
+      }
+
+   private:
+      uint64_t splitmix()
+      {
+         uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+         z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+         z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+         return z ^ (z >> 31);
+      }
+
+      uint64_t seed;
+      uint64_t accounts;
+      double alpha;
+      uint64_t min_cpu_us;
+      uint64_t max_cpu_us;
+      uint64_t state = 0;
+      uint64_t index = 0;
+   };
+
+   // rows already held in memory, e.g. sampled from a generator or shuffled
+   class usage_rows
+   {
+   public:
+      explicit usage_rows(std::vector<usage_row> rows) : rows(std::move(rows)) {}
+
+      void reset() { index = 0; }
+
+      bool next(usage_row &row)
+      {
+         if (index == rows.size())
+            return false;
+         row = rows[index++];
+         return true;
+      }
+
+   private:
+      std::vector<usage_row> rows;
+      size_t index = 0;
+   };
+
+   // rows of a tests/usage_data style file, parsed as they are read
+   class usage_file
+   {
+   public:
+      explicit usage_file(const std::string &path) : path(path) { reset(); }
+
+      void reset()
+      {
+         parser.reset();
+         in.close();
+         in.clear();
+         in.open(path, std::ios::binary);
+         FC_ASSERT(in, "cannot open ${path}", ("path", path));
+         parser.reset(new ux::aggregator::usage_parser(in));
+      }
+
+      bool next(usage_row &row) { return parser->next(row); }
+
+   private:
+      std::string path;
+      std::ifstream in;
+      std::unique_ptr<ux::aggregator::usage_parser> parser;
+   };
+
+   // write rows from a source in the tests/usage_data format, e.g. to feed the ux.aggregator tool
+   template <typename Source>
+   void write_json(Source &source, std::ostream &os)
+   {
+      usage_row row;
+      bool first = true;
+      os << "[\n";
+      while (source.next(row))
+      {
+         os << (first ? "" : ",\n") << "    {\"a\": \"" << ux::aggregator::name_to_string(row.account) << "\", \"u\": \"" << row.cpu_us << "\", \"net\": \"" << row.net_words << "\"}";
+         first = false;
+      }
+      os << "\n]\n";
+   }
+} // namespace ux_usage_data
@@ -0,0 +1,469 @@
+#pragma once
+
+#include <ux.aggregator/sha256.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <future>
+#include <istream>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// host side preparation of what an oracle submits each period: usage rows are summed per account,
+// sorted by name value and cut into dataset_batch_size batches, hashed exactly as settotalusg and addactusg hash them
+namespace ux { namespace aggregator {
+
+   // eosio::name encoding, throws on characters outside [.1-5a-z] or names longer than 13 characters
+   inline uint64_t string_to_name(const std::string& str) {
+      if (str.size() > 13) throw std::runtime_error("account name too long: " + str);
+      auto symbol = [&](char c) -> uint64_t {
+         if (c >= 'a' && c <= 'z') return (c - 'a') + 6;
+         if (c >= '1' && c <= '5') return (c - '1') + 1;
+         if (c == '.') return 0;
+         throw std::runtime_error("invalid character in account name: " + str);
+      };
+      uint64_t value = 0;
+      for (size_t i = 0; i < str.size() && i < 12; i++)
+         value |= (symbol(str[i]) & 0x1f) << (64 - 5 * (i + 1));
+      if (str.size() == 13) {
+         uint64_t last = symbol(str[12]);
+         if (last > 0x0f) throw std::runtime_error("invalid 13th character in account name: " + str);
+         value |= last;
+      }
+      return value;
+   }
+
+   inline std::string name_to_string(uint64_t value) {
+      static const char charmap[] = ".12345abcdefghijklmnopqrstuvwxyz";
+      std::string str(13, '.');
+      uint64_t tmp = value;
+      for (int i = 0; i <= 12; i++) {
+         char c = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+         str[12 - i] = c;
+         tmp >>= (i == 0 ? 4 : 5);
+      }
+      str.erase(str.find_last_not_of('.') + 1);
+      return str;
+   }
+
+   struct usage_row {
+      uint64_t account = 0;
+      uint64_t cpu_us = 0;
+      uint64_t net_words = 0;
+   };
+
+   // reads usage rows from either a JSON array of {"a", "u", "net"} objects, as in tests/usage_data,
+   // or one such object per line; numbers may be quoted and other keys are ignored
+   class usage_parser {
+   public:
+      explicit usage_parser(std::istream& in) : in(in), buffer(1 << 20) {}
+
+      bool next(usage_row& row) {
+         for (int c = skip_space(); c != eof; c = skip_space()) {
+            if (c == '[' || c == ']' || c == ',') {
+               get();
+               continue;
+            }
+            if (c != '{') fail("expected a usage object");
+            get();
+            parse_object(row);
+            return true;
+         }
+         return false;
+      }
+
+   private:
+      static constexpr int eof = -1;
+
+      int peek() {
+         if (pos == end) {
+            in.read(buffer.data(), buffer.size());
+            pos = 0;
+            end = static_cast<size_t>(in.gcount());
+            if (end == 0) return eof;
+         }
+         return static_cast<unsigned char>(buffer[pos]);
+      }
+
+      int get() {
+         int c = peek();
+         if (c != eof) {
+            pos++;
+            if (c == '\n') line++;
+         }
+         return c;
+      }
+
+      int skip_space() {
+         int c = peek();
+         while (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            get();
+            c = peek();
+         }
+         return c;
+      }
+
+      [[noreturn]] void fail(const std::string& what) {
+         throw std::runtime_error(what + " on line " + std::to_string(line));
+      }
+
+      void expect(char e) {
+         if (skip_space() != e) fail(std::string("expected '") + e + "'");
+         get();
+      }
+
+      std::string parse_string() {
+         std::string s;
+         for (int c = get(); c != '"'; c = get()) {
+            if (c == eof) fail("unterminated string");
+            if (c == '\\') c = get();
+            s.push_back(static_cast<char>(c));
+         }
+         return s;
+      }
+
+      // a bare or quoted unsigned integer, or any other scalar which is kept as text
+      std::string parse_value() {
+         int c = skip_space();
+         if (c == '"') {
+            get();
+            return parse_string();
+         }
+         if (c == '{' || c == '[') fail("nested values are not supported");
+         std::string s;
+         while (c != eof && c != ',' && c != '}' && c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+            s.push_back(static_cast<char>(get()));
+            c = peek();
+         }
+         if (s.empty()) fail("expected a value");
+         return s;
+      }
+
+      uint64_t to_uint(const std::string& s) {
+         if (s.empty() || s.size() > 20 || s.find_first_not_of("0123456789") != std::string::npos) fail("expected an unsigned integer");
+         uint64_t value = 0;
+         for (char c : s) {
+            if (__builtin_mul_overflow(value, 10, &value) || __builtin_add_overflow(value, uint64_t(c - '0'), &value))
+               fail("integer out of range");
+         }
+         return value;
+      }
+
+      void parse_object(usage_row& row) {
+         bool has_account = false, has_cpu = false;
+         row = usage_row{};
+         if (skip_space() == '}') {
+            get();
+            fail("usage object without \"a\" and \"u\"");
+         }
+         for (;;) {
+            expect('"');
+            std::string key = parse_string();
+            expect(':');
+            std::string value = parse_value();
+            if (key == "a") {
+               row.account = string_to_name(value);
+               has_account = true;
+            } else if (key == "u") {
+               row.cpu_us = to_uint(value);
+               has_cpu = true;
+            } else if (key == "net") {
+               row.net_words = to_uint(value);
+            }
+            int c = skip_space();
+            get();
+            if (c == '}') break;
+            if (c != ',') fail("expected ',' or '}'");
+         }
+         if (!has_account || !has_cpu) fail("usage object without \"a\" and \"u\"");
+      }
+
+      std::istream& in;
+      std::vector<char> buffer;
+      size_t pos = 0;
+      size_t end = 0;
+      uint64_t line = 1;
+   };
+
+   struct options {
+      uint32_t batch_size = 500; // resource_config_state::dataset_batch_size
+      uint8_t hash_version = 1; // resource_config_state::hash_version
+      size_t chunk_rows = size_t(1) << 22; // rows sorted per chunk, memory is about (threads + 1) * chunk_rows * 24 bytes
+      unsigned threads = 0; // chunk sorting threads, 0 for every core
+   };
+
+   struct summary {
+      uint64_t rows = 0; // input rows
+      uint64_t accounts = 0; // distinct accounts after aggregation
+      uint64_t datasets = 0;
+      uint64_t total_cpu_us = 0;
+      uint64_t total_net_words = 0;
+      digest totals_hash{}; // dataset 0, the settotalusg totals
+      digest all_data_hash{}; // merkle root over the totals and every dataset, the settotalusg commitment
+   };
+
+   // called for each dataset in submission order, dataset ids start at 1
+   using dataset_callback = std::function<void(uint32_t dataset_id, const std::vector<usage_row>& dataset, const digest& hash)>;
+
+   // hash of a dataset as hash_dataset in resource.cpp computes it
+   inline digest hash_dataset(const std::vector<usage_row>& dataset, uint8_t hash_version) {
+      sha256 h;
+      if (hash_version == 0) {
+         for (const auto& r : dataset) {
+            std::string text = name_to_string(r.account) + std::to_string(r.cpu_us);
+            h.update(text.data(), text.size());
+         }
+         return h.finish();
+      }
+      uint8_t bytes[10];
+      size_t n = 0;
+      uint64_t count = dataset.size();
+      do {
+         uint8_t b = count & 0x7f;
+         count >>= 7;
+         bytes[n++] = count ? b | 0x80 : b;
+      } while (count);
+      h.update(bytes, n);
+      for (const auto& r : dataset) {
+         uint8_t packed[16];
+         for (int i = 0; i < 8; i++) {
+            packed[i] = static_cast<uint8_t>(r.account >> (8 * i));
+            packed[8 + i] = static_cast<uint8_t>(r.cpu_us >> (8 * i));
+         }
+         h.update(packed, sizeof(packed));
+      }
+      return h.finish();
+   }
+
+   // hash of the totals as settotalusg computes it
+   inline digest hash_totals(uint64_t total_cpu_us, uint64_t total_net_words, uint8_t hash_version) {
+      if (hash_version == 0) {
+         std::string text = std::to_string(total_cpu_us) + "-" + std::to_string(total_net_words);
+         return sha256::hash(text.data(), text.size());
+      }
+      return hash_dataset({{string_to_name("cpu.us"), total_cpu_us, 0}, {string_to_name("net.words"), total_net_words, 0}}, hash_version);
+   }
+
+   inline digest merkle_parent(const digest& left, const digest& right) {
+      sha256 h;
+      h.update(left.data(), left.size());
+      h.update(right.data(), right.size());
+      return h.finish();
+   }
+
+   // incremental merkle frontier, the same as merkle_append and merkle_root in resource.cpp
+   class merkle_frontier {
+   public:
+      void append(digest leaf) {
+         for (uint64_t n = count++; n & 1; n >>= 1) {
+            leaf = merkle_parent(peaks.back(), leaf);
+            peaks.pop_back();
+         }
+         peaks.push_back(leaf);
+      }
+
+      digest root() const {
+         digest r = peaks.back();
+         for (size_t i = peaks.size() - 1; i > 0; i--)
+            r = merkle_parent(peaks[i - 1], r);
+         return r;
+      }
+
+   private:
+      std::vector<digest> peaks;
+      uint64_t count = 0;
+   };
+
+   namespace detail {
+
+      inline void add(uint64_t& sum, uint64_t value) {
+         if (__builtin_add_overflow(sum, value, &sum)) throw std::runtime_error("usage total out of range");
+      }
+
+      // sort by account and merge duplicate accounts in place
+      inline void sort_and_fold(std::vector<usage_row>& rows) {
+         std::sort(rows.begin(), rows.end(), [](const usage_row& a, const usage_row& b) { return a.account < b.account; });
+         size_t out = 0;
+         for (size_t i = 0; i < rows.size(); i++) {
+            if (out > 0 && rows[out - 1].account == rows[i].account) {
+               add(rows[out - 1].cpu_us, rows[i].cpu_us);
+               add(rows[out - 1].net_words, rows[i].net_words);
+            } else {
+               rows[out++] = rows[i];
+            }
+         }
+         rows.resize(out);
+      }
+
+      struct file_closer {
+         void operator()(std::FILE* f) const { std::fclose(f); }
+      };
+      using file_ptr = std::unique_ptr<std::FILE, file_closer>;
+
+      // a sorted chunk spilled to an anonymous temporary file
+      inline file_ptr spill(const std::vector<usage_row>& rows) {
+         file_ptr f(std::tmpfile());
+         if (!f) throw std::runtime_error("cannot create temporary file");
+         if (std::fwrite(rows.data(), sizeof(usage_row), rows.size(), f.get()) != rows.size())
+            throw std::runtime_error("cannot write temporary file");
+         std::rewind(f.get());
+         return f;
+      }
+
+      class run_reader {
+      public:
+         explicit run_reader(file_ptr f) : file(std::move(f)), buffer(8192) { refill(); }
+
+         bool done() const { return pos == count; }
+         const usage_row& front() const { return buffer[pos]; }
+         void pop() {
+            if (++pos == count) refill();
+         }
+
+      private:
+         void refill() {
+            count = std::fread(buffer.data(), sizeof(usage_row), buffer.size(), file.get());
+            pos = 0;
+         }
+
+         file_ptr file;
+         std::vector<usage_row> buffer;
+         size_t pos = 0;
+         size_t count = 0;
+      };
+
+      // k-way merge of sorted runs, folding accounts which appear in more than one run
+      template <typename Sink>
+      void merge_runs(std::vector<file_ptr>& runs, Sink&& sink) {
+         std::vector<run_reader> readers;
+         readers.reserve(runs.size());
+         for (auto& f : runs)
+            readers.emplace_back(std::move(f));
+         runs.clear();
+         auto later = [&](size_t a, size_t b) { return readers[a].front().account > readers[b].front().account; };
+         std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+         for (size_t i = 0; i < readers.size(); i++)
+            if (!readers[i].done()) heap.push(i);
+
+         bool has_current = false;
+         usage_row current;
+         while (!heap.empty()) {
+            size_t i = heap.top();
+            heap.pop();
+            const usage_row& r = readers[i].front();
+            if (has_current && current.account == r.account) {
+               add(current.cpu_us, r.cpu_us);
+               add(current.net_words, r.net_words);
+            } else {
+               if (has_current) sink(current);
+               current = r;
+               has_current = true;
+            }
+            readers[i].pop();
+            if (!readers[i].done()) heap.push(i);
+         }
+         if (has_current) sink(current);
+      }
+
+      // merge runs into one so the number of open temporary files stays bounded
+      inline file_ptr compact_runs(std::vector<file_ptr>& runs) {
+         file_ptr f(std::tmpfile());
+         if (!f) throw std::runtime_error("cannot create temporary file");
+         merge_runs(runs, [&](const usage_row& r) {
+            if (std::fwrite(&r, sizeof(r), 1, f.get()) != 1) throw std::runtime_error("cannot write temporary file");
+         });
+         std::rewind(f.get());
+         return f;
+      }
+
+      constexpr size_t max_runs = 64;
+
+   }
+
+   // stream rows from in, aggregate them in bounded memory and emit the batches an oracle submits
+   inline summary aggregate(std::istream& in, const options& opts, const dataset_callback& on_dataset = {}) {
+      if (opts.batch_size == 0) throw std::runtime_error("batch size must be positive");
+      if (opts.hash_version > 1) throw std::runtime_error("unsupported hash version");
+      const size_t chunk_rows = std::max<size_t>(opts.chunk_rows, 1);
+      unsigned threads = opts.threads ? opts.threads : std::max(1u, std::thread::hardware_concurrency());
+
+      summary res;
+      usage_parser parser(in);
+
+      // parse on this thread while up to `threads` chunks are sorted and spilled in the background
+      std::deque<std::future<detail::file_ptr>> pending;
+      std::vector<detail::file_ptr> runs;
+      std::vector<usage_row> chunk;
+      chunk.reserve(std::min<size_t>(chunk_rows, 1 << 16));
+      bool spilled = false;
+
+      usage_row row;
+      for (bool more = parser.next(row); more || !chunk.empty();) {
+         if (more) {
+            res.rows++;
+            detail::add(res.total_cpu_us, row.cpu_us);
+            detail::add(res.total_net_words, row.net_words);
+            chunk.push_back(row);
+            more = parser.next(row);
+         }
+         if (chunk.size() < chunk_rows && more) continue;
+         if (!more && !spilled) break; // the whole input fits in one chunk, keep it in memory
+
+         if (pending.size() >= threads) {
+            runs.push_back(pending.front().get());
+            pending.pop_front();
+            if (runs.size() >= detail::max_runs) {
+               auto merged = detail::compact_runs(runs);
+               runs.push_back(std::move(merged));
+            }
+         }
+         pending.push_back(std::async(std::launch::async, [rows = std::move(chunk)]() mutable {
+            detail::sort_and_fold(rows);
+            return detail::spill(rows);
+         }));
+         chunk = std::vector<usage_row>();
+         chunk.reserve(std::min<size_t>(chunk_rows, 1 << 16));
+         spilled = true;
+      }
+      for (auto& p : pending)
+         runs.push_back(p.get());
+
+      res.totals_hash = hash_totals(res.total_cpu_us, res.total_net_words, opts.hash_version);
+      merkle_frontier frontier;
+      frontier.append(res.totals_hash);
+
+      std::vector<usage_row> batch;
+      batch.reserve(std::min<size_t>(opts.batch_size, 1 << 16));
+      auto flush = [&]() {
+         digest h = hash_dataset(batch, opts.hash_version);
+         frontier.append(h);
+         res.datasets++;
+         if (on_dataset) on_dataset(static_cast<uint32_t>(res.datasets), batch, h);
+         batch.clear();
+      };
+      auto emit = [&](const usage_row& r) {
+         res.accounts++;
+         batch.push_back(r);
+         if (batch.size() == opts.batch_size) flush();
+      };
+
+      if (!spilled) {
+         detail::sort_and_fold(chunk);
+         for (const auto& r : chunk)
+            emit(r);
+      } else {
+         detail::merge_runs(runs, emit);
+      }
+      if (!batch.empty()) flush();
+
+      res.all_data_hash = frontier.root();
+      return res;
+   }
+
+} }
@@ -0,0 +1,85 @@
+#include <ux.aggregator/aggregator.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+   void usage(const char* argv0) {
+      std::cerr << "Usage: " << argv0 << " [OPTION]... [FILE]\n"
+                   "Aggregate per account usage from FILE (default stdin) into the totals, datasets and all_data_hash an oracle submits.\n"
+                   "FILE is a JSON array of {\"a\", \"u\", \"net\"} objects or one such object per line.\n\n"
+                   "  --batch-size N     dataset_batch_size (default 500)\n"
+                   "  --hash-version N   hash_version, 0 or 1 (default 1)\n"
+                   "  --chunk-rows N     rows sorted in memory per chunk before spilling (default 4194304)\n"
+                   "  --threads N        sorting threads, 0 for every core (default 0)\n"
+                   "  --datasets FILE    write one {\"dataset_id\", \"hash\", \"dataset\"} object per line to FILE\n";
+      std::exit(1);
+   }
+
+}
+
+int main(int argc, char** argv) {
+   ux::aggregator::options opts;
+   std::string input, datasets;
+
+   for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      auto value = [&]() -> std::string {
+         if (i + 1 >= argc) usage(argv[0]);
+         return argv[++i];
+      };
+      if (arg == "--batch-size") opts.batch_size = std::stoul(value());
+      else if (arg == "--hash-version") opts.hash_version = std::stoul(value());
+      else if (arg == "--chunk-rows") opts.chunk_rows = std::stoull(value());
+      else if (arg == "--threads") opts.threads = std::stoul(value());
+      else if (arg == "--datasets") datasets = value();
+      else if (arg.size() > 1 && arg[0] == '-') usage(argv[0]);
+      else if (input.empty()) input = arg;
+      else usage(argv[0]);
+   }
+
+   std::ifstream file;
+   if (!input.empty()) {
+      file.open(input, std::ios::binary);
+      if (!file) {
+         std::cerr << "cannot open " << input << "\n";
+         return 1;
+      }
+   }
+   std::istream& in = input.empty() ? std::cin : file;
+
+   std::ofstream out;
+   ux::aggregator::dataset_callback on_dataset;
+   if (!datasets.empty()) {
+      out.open(datasets);
+      if (!out) {
+         std::cerr << "cannot open " << datasets << "\n";
+         return 1;
+      }
+      on_dataset = [&](uint32_t id, const std::vector<ux::aggregator::usage_row>& dataset, const ux::aggregator::digest& hash) {
+         out << "{\"dataset_id\":" << id << ",\"hash\":\"" << ux::aggregator::to_hex(hash) << "\",\"dataset\":[";
+         for (size_t i = 0; i < dataset.size(); i++)
+            out << (i ? "," : "") << "{\"a\":\"" << ux::aggregator::name_to_string(dataset[i].account) << "\",\"u\":" << dataset[i].cpu_us << "}";
+         out << "]}\n";
+      };
+   }
+
+   auto start = std::chrono::steady_clock::now();
+   ux::aggregator::summary res;
+   try {
+      res = ux::aggregator::aggregate(in, opts, on_dataset);
+   } catch (const std::exception& e) {
+      std::cerr << e.what() << "\n";
+      return 1;
+   }
+   auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+   std::cout << "{\"total_cpu_us\":" << res.total_cpu_us << ",\"total_net_words\":" << res.total_net_words
+             << ",\"all_data_hash\":\"" << ux::aggregator::to_hex(res.all_data_hash) << "\",\"datasets\":" << res.datasets
+             << ",\"accounts\":" << res.accounts << "}\n";
+   std::cerr << res.rows << " rows aggregated in " << elapsed << " ms\n";
+   return 0;
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <eosio.system/inflation_model.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// host side replay of system_contract::set_total and issue_inflation over a usage path,
+// using the same fixed point model so each row matches what reshistory would hold on chain
+namespace ux { namespace simulator {
+
+   // totals an oracle would submit with settotalusg for one period
+   struct usage_sample {
+      uint64_t total_cpu_us = 0;
+      uint64_t total_net_words = 0;
+   };
+
+   struct config {
+      uint64_t max_block_cpu_usage = 200000; // eosio_global_state values the capacity is derived from
+      uint64_t max_block_net_usage = 1048576;
+      double initial_value_transfer_rate = 0.1;
+      double max_pay_constant = 0.2947;
+      uint32_t emadraglimit = 2;
+      int64_t supply = 0; // core token supply and max supply in the token's smallest unit
+      int64_t max_supply = 0;
+      int64_t period_inflation_cap = 15000000000; // 1.5m UTX, the issue_inflation cap
+   };
+
+   // one reshistory row, token amounts in the core token's smallest unit
+   struct history_row {
+      uint32_t daycount = 0;
+      uint64_t total_cpu_us = 0;
+      uint64_t total_net_words = 0;
+      double net_percent_total = 0;
+      double cpu_percent_total = 0;
+      double use_cpu = 0;
+      double use_net = 0;
+      double ma_cpu = 0;
+      double ma_net = 0;
+      double ema_cpu = 0;
+      double ema_net = 0;
+      double ema_util_total = 0;
+      double utility = 0;
+      double utility_daily = 0;
+      double bppay = 0;
+      double bppay_daily = 0;
+      double inflation = 0;
+      double inflation_daily = 0;
+      int64_t utility_tokens = 0;
+      int64_t bppay_tokens = 0;
+      int64_t supply = 0; // token supply after the period's issue
+   };
+
+   struct result {
+      std::vector<history_row> rows;
+      std::string error; // assertion settotalusg would have failed with, the path stops there
+   };
+
+   // inflation stops after 1096 periods, as in set_total
+   constexpr uint64_t max_periods = 1096;
+
+   inline result simulate(const config& cfg, const std::vector<usage_sample>& path) {
+      result res;
+
+      const uint64_t system_max_cpu = cfg.max_block_cpu_usage * 2 * 60 * 60 * 24;
+      const uint64_t system_max_net = cfg.max_block_net_usage * 2 * 60 * 60 * 24;
+      const uint64_t window = cfg.emadraglimit - 1;
+
+      // initinfl writes a zero history row which the moving average window starts from
+      std::deque<fixed> cpu_samples, net_samples;
+      fixed cpu_sum, net_sum, previous_ma_cpu, previous_ma_net;
+      if (window > 0) {
+         cpu_samples.push_back(fixed());
+         net_samples.push_back(fixed());
+      }
+
+      int64_t supply = cfg.supply;
+      const uint64_t periods = std::min<uint64_t>(path.size(), max_periods);
+      res.rows.reserve(periods);
+
+      for (uint64_t day = 0; day < periods; day++) {
+         const usage_sample& s = path[day];
+         if (s.total_cpu_us > system_max_cpu) {
+            res.error = "measured cpu usage is greater than system total";
+            break;
+         }
+         if (s.total_net_words * 8 > system_max_net) {
+            res.error = "measured net usage is greater than system total";
+            break;
+         }
+
+         inflation_inputs in;
+         in.day_count = day;
+         in.history_count = day + 1;
+         in.draglimit = cfg.emadraglimit;
+         in.usage_cpu = usage_fraction(s.total_cpu_us, system_max_cpu);
+         in.usage_net = usage_fraction(s.total_net_words * 8, system_max_net);
+         in.ma_cpu_total = cpu_sum;
+         in.ma_net_total = net_sum;
+         in.previous_ma_cpu = previous_ma_cpu;
+         in.previous_ma_net = previous_ma_net;
+         in.initial_value_transfer_rate = fixed::from_double(cfg.initial_value_transfer_rate);
+         in.max_pay_constant = fixed::from_double(cfg.max_pay_constant);
+
+         inflation_outputs out = compute_inflation(in);
+         fixed usage_total = in.usage_cpu + in.usage_net;
+
+         history_row h;
+         h.daycount = day + 1;
+         h.total_cpu_us = s.total_cpu_us;
+         h.total_net_words = s.total_net_words;
+         h.net_percent_total = (in.usage_net / usage_total).to_double();
+         h.cpu_percent_total = (in.usage_cpu / usage_total).to_double();
+         h.use_cpu = in.usage_cpu.to_double();
+         h.use_net = in.usage_net.to_double();
+         h.ma_cpu = out.ma_cpu.to_double();
+         h.ma_net = out.ma_net.to_double();
+         h.ema_cpu = out.ema_cpu.to_double();
+         h.ema_net = out.ema_net.to_double();
+         h.ema_util_total = out.ema_util_total.to_double();
+         h.utility = out.utility.to_double();
+         h.utility_daily = out.utility_daily.to_double();
+         h.bppay = out.bppay.to_double();
+         h.bppay_daily = out.bppay_daily.to_double();
+         h.inflation = out.inflation.to_double();
+         h.inflation_daily = out.inflation_daily.to_double();
+         h.utility_tokens = (out.cpu_pay * supply).to_int();
+         h.bppay_tokens = (out.final_bp_daily * supply).to_int();
+
+         // issue_inflation
+         int64_t inflation = h.bppay_tokens + h.utility_tokens;
+         if (inflation > cfg.period_inflation_cap) {
+            res.error = "period inflation cap exceeded";
+            break;
+         }
+         int64_t supply_remaining = cfg.max_supply - supply;
+         if (supply_remaining <= 0) {
+            res.error = "cannot exceed max token supply";
+            break;
+         }
+         if (inflation > supply_remaining) {
+            h.bppay_tokens = static_cast<int64_t>(static_cast<__int128>(h.bppay_tokens) * supply_remaining / inflation);
+            h.utility_tokens = supply_remaining - h.bppay_tokens;
+            inflation = supply_remaining;
+         }
+         if (inflation > 0) supply += inflation;
+         h.supply = supply;
+         res.rows.push_back(h);
+
+         // the contract's rolling window, newest sample in and oldest out once full
+         previous_ma_cpu = out.ma_cpu;
+         previous_ma_net = out.ma_net;
+         if (window > 0) {
+            cpu_samples.push_back(in.usage_cpu);
+            net_samples.push_back(in.usage_net);
+            cpu_sum = cpu_sum + in.usage_cpu;
+            net_sum = net_sum + in.usage_net;
+            if (cpu_samples.size() > window) {
+               cpu_sum = cpu_sum - cpu_samples.front();
+               net_sum = net_sum - net_samples.front();
+               cpu_samples.pop_front();
+               net_samples.pop_front();
+            }
+         }
+      }
+
+      return res;
+   }
+
+   // simulate every path, spreading them across threads (0 uses every core)
+   inline std::vector<result> simulate_all(const config& cfg, const std::vector<std::vector<usage_sample>>& paths, unsigned threads = 0) {
+      if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+      threads = std::min<unsigned>(threads, std::max<size_t>(1, paths.size()));
+
+      std::vector<result> results(paths.size());
+      std::atomic<size_t> next{0};
+      auto worker = [&]() {
+         for (size_t i = next++; i < paths.size(); i = next++) {
+            results[i] = simulate(cfg, paths[i]);
+         }
+      };
+
+      std::vector<std::thread> pool;
+      for (unsigned t = 1; t < threads; t++) pool.emplace_back(worker);
+      worker();
+      for (auto& t : pool) t.join();
+      return results;
+   }
+
+   inline void write_csv_header(std::ostream& os) {
+      os << "path,daycount,total_cpu_us,total_net_words,net_percent_total,cpu_percent_total,use_cpu,use_net,"
+            "ma_cpu,ma_net,ema_cpu,ema_net,ema_util_total,utility,utility_daily,bppay,bppay_daily,"
+            "inflation,inflation_daily,utility_tokens,bppay_tokens,supply\n";
+   }
+
+   inline void write_csv(std::ostream& os, size_t path, const result& res) {
+      auto precision = os.precision(17);
+      for (const auto& h : res.rows) {
+         os << path << ',' << h.daycount << ',' << h.total_cpu_us << ',' << h.total_net_words << ','
+            << h.net_percent_total << ',' << h.cpu_percent_total << ',' << h.use_cpu << ',' << h.use_net << ','
+            << h.ma_cpu << ',' << h.ma_net << ',' << h.ema_cpu << ',' << h.ema_net << ',' << h.ema_util_total << ','
+            << h.utility << ',' << h.utility_daily << ',' << h.bppay << ',' << h.bppay_daily << ','
+            << h.inflation << ',' << h.inflation_daily << ',' << h.utility_tokens << ',' << h.bppay_tokens << ','
+            << h.supply << '\n';
+      }
+      os.precision(precision);
+   }
+
+} }
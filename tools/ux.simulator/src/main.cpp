@@ -0,0 +1,149 @@
+#include <ux.simulator/simulator.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace {
+
+   void usage(const char* argv0) {
+      std::cerr << "Usage: " << argv0 << " [OPTION]...\n"
+                   "Simulate the UX inflation schedule for many utilisation paths and write reshistory rows as CSV.\n\n"
+                   "  --paths N          number of generated paths (default 1000)\n"
+                   "  --days N           periods per path, at most 1096 (default 1096)\n"
+                   "  --utilisation X    mean cpu utilisation of generated paths, 0 to 1 (default 0.5)\n"
+                   "  --volatility X     daily relative deviation of generated paths (default 0.1)\n"
+                   "  --net-ratio X      net utilisation as a share of cpu utilisation (default 0.5)\n"
+                   "  --seed N           random seed (default 1)\n"
+                   "  --input FILE       simulate one path read from FILE, one 'total_cpu_us,total_net_words' line per period\n"
+                   "  --ivtr X           initial_value_transfer_rate (default 0.1)\n"
+                   "  --mp X             max_pay_constant (default 0.2947)\n"
+                   "  --draglimit N      emadraglimit (default 2)\n"
+                   "  --supply N         starting core token supply in the smallest unit (default 16392589380000)\n"
+                   "  --max-supply N     core token max supply in the smallest unit (default 25000000000000)\n"
+                   "  --block-cpu N      max_block_cpu_usage (default 200000)\n"
+                   "  --block-net N      max_block_net_usage (default 1048576)\n"
+                   "  --threads N        worker threads, 0 for every core (default 0)\n"
+                   "  --output FILE      CSV destination (default stdout)\n"
+                   "  --summary          write only the last row of each path\n";
+      std::exit(1);
+   }
+
+   std::vector<ux::simulator::usage_sample> read_path(const std::string& file) {
+      std::ifstream in(file);
+      if (!in) {
+         std::cerr << "cannot open " << file << "\n";
+         std::exit(1);
+      }
+      std::vector<ux::simulator::usage_sample> path;
+      std::string line;
+      while (std::getline(in, line)) {
+         if (line.empty() || line[0] == '#') continue;
+         std::istringstream ss(line);
+         ux::simulator::usage_sample s;
+         char comma;
+         if (!(ss >> s.total_cpu_us >> comma >> s.total_net_words)) {
+            std::cerr << "malformed line in " << file << ": " << line << "\n";
+            std::exit(1);
+         }
+         path.push_back(s);
+      }
+      return path;
+   }
+
+   // utilisation drifting around the mean, each path with its own generator so results do not depend on threading
+   std::vector<ux::simulator::usage_sample> generate_path(const ux::simulator::config& cfg, uint64_t days, double mean,
+                                                          double volatility, double net_ratio, uint64_t seed) {
+      std::mt19937_64 rng(seed);
+      std::normal_distribution<double> noise(0.0, volatility);
+      const double cpu_capacity = double(cfg.max_block_cpu_usage) * 2 * 60 * 60 * 24;
+      const double net_capacity = double(cfg.max_block_net_usage) * 2 * 60 * 60 * 24 / 8;
+
+      std::vector<ux::simulator::usage_sample> path(days);
+      for (auto& s : path) {
+         double u = std::min(1.0, std::max(0.0, mean * (1.0 + noise(rng))));
+         s.total_cpu_us = static_cast<uint64_t>(u * cpu_capacity);
+         s.total_net_words = static_cast<uint64_t>(std::min(1.0, u * net_ratio) * net_capacity);
+      }
+      return path;
+   }
+
+}
+
+int main(int argc, char** argv) {
+   ux::simulator::config cfg;
+   cfg.supply = 16392589380000;
+   cfg.max_supply = 25000000000000;
+
+   uint64_t paths = 1000, days = ux::simulator::max_periods, seed = 1;
+   double mean = 0.5, volatility = 0.1, net_ratio = 0.5;
+   unsigned threads = 0;
+   bool summary = false;
+   std::string input, output;
+
+   for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      auto value = [&]() -> std::string {
+         if (i + 1 >= argc) usage(argv[0]);
+         return argv[++i];
+      };
+      if (arg == "--paths") paths = std::stoull(value());
+      else if (arg == "--days") days = std::min<uint64_t>(std::stoull(value()), ux::simulator::max_periods);
+      else if (arg == "--utilisation") mean = std::stod(value());
+      else if (arg == "--volatility") volatility = std::stod(value());
+      else if (arg == "--net-ratio") net_ratio = std::stod(value());
+      else if (arg == "--seed") seed = std::stoull(value());
+      else if (arg == "--input") input = value();
+      else if (arg == "--ivtr") cfg.initial_value_transfer_rate = std::stod(value());
+      else if (arg == "--mp") cfg.max_pay_constant = std::stod(value());
+      else if (arg == "--draglimit") cfg.emadraglimit = std::stoul(value());
+      else if (arg == "--supply") cfg.supply = std::stoll(value());
+      else if (arg == "--max-supply") cfg.max_supply = std::stoll(value());
+      else if (arg == "--block-cpu") cfg.max_block_cpu_usage = std::stoull(value());
+      else if (arg == "--block-net") cfg.max_block_net_usage = std::stoull(value());
+      else if (arg == "--threads") threads = std::stoul(value());
+      else if (arg == "--output") output = value();
+      else if (arg == "--summary") summary = true;
+      else usage(argv[0]);
+   }
+   if (cfg.emadraglimit < 1 || cfg.emadraglimit > 255) {
+      std::cerr << "draglimit must be between 1 and 255\n";
+      return 1;
+   }
+
+   std::vector<std::vector<ux::simulator::usage_sample>> usage_paths;
+   if (!input.empty()) {
+      usage_paths.push_back(read_path(input));
+   } else {
+      usage_paths.reserve(paths);
+      for (uint64_t p = 0; p < paths; p++)
+         usage_paths.push_back(generate_path(cfg, days, mean, volatility, net_ratio, seed + p));
+   }
+
+   auto start = std::chrono::steady_clock::now();
+   auto results = ux::simulator::simulate_all(cfg, usage_paths, threads);
+   auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+   std::ofstream file;
+   if (!output.empty()) file.open(output);
+   std::ostream& os = output.empty() ? std::cout : file;
+
+   ux::simulator::write_csv_header(os);
+   for (size_t p = 0; p < results.size(); p++) {
+      if (!results[p].error.empty())
+         std::cerr << "path " << p << " stopped after " << results[p].rows.size() << " periods: " << results[p].error << "\n";
+      if (summary && !results[p].rows.empty()) {
+         ux::simulator::result last;
+         last.rows.push_back(results[p].rows.back());
+         ux::simulator::write_csv(os, p, last);
+      } else {
+         ux::simulator::write_csv(os, p, results[p]);
+      }
+   }
+
+   std::cerr << results.size() << " paths simulated in " << elapsed << " ms\n";
+   return 0;
+}